@@ -1,39 +1,203 @@
 #include "AI.h"
+
+#include <algorithm>
+
+#include "Evaluation.h"
 #include "GameStates.h"
+#include "LeafEval.h"
+#include "Profiler.h"
 
 using namespace std;
 
 #define DEPTH 3
+#define MAX_SEARCH_DEPTH 32
+// Nodes searched between looks at the clock
+#define CLOCK_CHECK_NODES 1024
+// Games a position needs in the book before its moves are trusted, and
+// games each candidate move needs
+#define BOOK_MIN_GAMES 20
+#define BOOK_MIN_MOVE_GAMES 5
+#define MAX_MOVES ((BOARD_WIDTH - 1) * BOARD_HEIGHT + BOARD_WIDTH * (BOARD_HEIGHT - 1))
+// Limits on the threat extension below each leaf
+#define EXTENSION_MAX_PLY 8
+#define EXTENSION_MAX_NODES 256
 
 namespace AI {
+	static EvalTables MakeTables(const EvalWeights& w) {
+		EvalTables t;
+		Eval::BuildTables(w, t);
+		return t;
+	}
+	static EvalWeights weights = Eval::DefaultWeights();
+	static EvalTables tables = MakeTables(weights);
+	void SetWeights(const EvalWeights& w) {
+		weights = w;
+		Eval::BuildTables(w, tables);
+	}
+	const EvalWeights& GetWeights() {
+		return weights;
+	}
+	const EvalTables& GetTables() {
+		return tables;
+	}
 	int Heuristic(Player p, GameState s) {
 		Player w = GetWinner(s);
 		if (w != PLAYER_NONE) {
-			return p == w ? 5 * BOARD_WIDTH : -5 * BOARD_WIDTH;
-		}
-		int result = 0;
-		for (int i = 0; i < BOARD_WIDTH; i++) {
-			if (!(s & STATE_BIT(i))) {
-				result += 1;
-			}
-		}
-		for (int i = (BOARD_HEIGHT - 1) * BOARD_WIDTH; i < BOARD_CELLS; i++) {
-			if (s & STATE_BIT(i)) {
-				result -= 1;
-			}
+			return p == w ? EVAL_WIN : -EVAL_WIN;
 		}
+		int result = Eval::Evaluate(tables, s);
 		if (p == PLAYER_WHITE) {
 			return -result;
 		} else {
 			return result;
 		}
 	}
-	int Negamax(const Move & root, int depth, int alpha, int beta, Player player, int & swapPos, bool & vertical) {
+	static bool extensions = true;
+	void SetExtensions(bool enabled) {
+		extensions = enabled;
+	}
+	bool GetExtensions() {
+		return extensions;
+	}
+	// Reads the clock once every CLOCK_CHECK_NODES nodes, counting leaves and
+	// extension nodes too, and returns whether the search should unwind
+	static bool Aborted(SearchControl* control) {
+		if (!control) return false;
+		if (control->nodes >= control->nextCheck) {
+			control->nextCheck = control->nodes + CLOCK_CHECK_NODES;
+			if (control->time && control->time->OutOfTime()) control->aborted = true;
+		}
+		return control->aborted;
+	}
+	// Whether either side could win with the next swap
+	static bool HasThreat(GameState s) {
+		int pos;
+		return RowTables::WinningSwap(s, PLAYER_BLACK, pos) || RowTables::WinningSwap(s, PLAYER_WHITE, pos);
+	}
+	// Searches past a leaf while someone is one swap from winning. The side
+	// to move takes a win if it has one; facing a threat it may only play
+	// the swaps that remove it, which all touch the goal row under threat or
+	// the row next to it; otherwise the position is quiet and scored as is.
+	// Only the ply limit and the node budget leave a threat unresolved.
+	static int Extend(const Move & node, int ply, int alpha, int beta, Player player, SearchControl* control, int & budget) {
+		budget--;
+		// The leaf itself was counted by the main search
+		if (control && ply > 0) {
+			control->nodes++;
+			control->extensionNodes++;
+		}
+		if (Aborted(control)) return 0;
+		if (GetWinner(node.result) != PLAYER_NONE) return Heuristic(player, node.result);
+		int pos;
+		if (RowTables::WinningSwap(node.result, player, pos)) return EVAL_WIN;
+		Player opponent = OtherPlayer(player);
+		if (!RowTables::WinningSwap(node.result, opponent, pos) || ply >= EXTENSION_MAX_PLY || budget <= 0) {
+			return Heuristic(player, node.result);
+		}
+		// Rows the defending swaps may touch: the threatened goal row, its
+		// neighbour, and the row past that for vertical swaps into the neighbour
+		int firstRow = opponent == PLAYER_BLACK ? 0 : BOARD_HEIGHT - 2;
+		int bestScore = -EVAL_WIN;
+		Move child;
+		child.previous = &node;
+		for (int v = 0; v < 2; v++) {
+			int startRow = v && opponent == PLAYER_WHITE ? firstRow - 1 : firstRow;
+			for (int y = startRow; y < startRow + 2; y++) {
+				for (int x = 0; x < (v ? BOARD_WIDTH : BOARD_WIDTH - 1); x++) {
+					child.swapPos = y * BOARD_WIDTH + x;
+					child.vertical = !!v;
+					child.result = PerformSwap(node.result, child.swapPos, child.vertical);
+					// A defence must leave no win behind, including one it completes itself
+					if (GetWinner(child.result) != PLAYER_NONE) continue;
+					if (RowTables::WinningSwap(child.result, opponent, pos)) continue;
+					if (node.IsIllegalState(child.result)) continue;
+					int score = -Extend(child, ply + 1, -beta, -alpha, opponent, control, budget);
+					if (control && control->aborted) return 0;
+					if (score > bestScore) bestScore = score;
+					if (score > alpha) alpha = score;
+					if (alpha >= beta) return bestScore;
+				}
+			}
+		}
+		return bestScore;
+	}
+	static int ScoreLeaf(const Move & leaf, int alpha, int beta, Player player, SearchControl* control) {
+		int budget = EXTENSION_MAX_NODES;
+		return Extend(leaf, 0, alpha, beta, player, control, budget);
+	}
+	// The children of a depth-1 node are all leaves, so they are generated
+	// in place and evaluated as one batch instead of recursing into each
+	static int NegamaxFrontier(const Move & root, int alpha, int beta, Player player, int & swapPos, bool & vertical,
+		SearchControl* control) {
+		GameState states[MAX_MOVES];
+		int positions[MAX_MOVES];
+		bool verticals[MAX_MOVES];
+		int scores[MAX_MOVES];
+		int count = 0;
+		// Same order as GetNextMoves
+		for (int v = 0; v < 2; v++) {
+			int width = v ? BOARD_WIDTH : BOARD_WIDTH - 1;
+			int height = v ? BOARD_HEIGHT - 1 : BOARD_HEIGHT;
+			for (int y = 0; y < height; y++) {
+				for (int x = 0; x < width; x++) {
+					int pos = y * BOARD_WIDTH + x;
+					GameState next = PerformSwap(root.result, pos, !!v);
+					if (root.IsIllegalState(next)) continue;
+					states[count] = next;
+					positions[count] = pos;
+					verticals[count] = !!v;
+					count++;
+				}
+			}
+		}
+		LeafEval::Evaluate(tables, OtherPlayer(player), states, count, scores);
+		if (control) control->nodes += count;
+		if (extensions) {
+			// Leaves with a win in the air are searched on; the rest keep their batch score
+			Move leaf;
+			leaf.previous = &root;
+			for (int i = 0; i < count; i++) {
+				if (GetWinner(states[i]) != PLAYER_NONE || !HasThreat(states[i])) continue;
+				leaf.swapPos = positions[i];
+				leaf.vertical = verticals[i];
+				leaf.result = states[i];
+				scores[i] = ScoreLeaf(leaf, -INT_MAX, INT_MAX, OtherPlayer(player), control);
+				if (control && control->aborted) return 0;
+			}
+		}
+		int bestScore = -INT_MAX;
+		swapPos = 0;
+		vertical = false;
+		for (int i = 0; i < count; i++) {
+			int newScore = -scores[i];
+			if (newScore > bestScore) {
+				bestScore = newScore;
+				swapPos = positions[i];
+				vertical = verticals[i];
+			}
+			if (alpha <= newScore) alpha = newScore;
+			if (alpha >= beta) break;
+		}
+		return bestScore;
+	}
+	int Negamax(const Move & root, int depth, int alpha, int beta, Player player, int & swapPos, bool & vertical,
+		SearchControl* control) {
+		if (control) control->nodes++;
+		if (Aborted(control)) return 0;
 		if (depth <= 0 || GetWinner(root.result) != PLAYER_NONE) {
 			swapPos = root.swapPos;
 			vertical = root.vertical;
+			if (extensions && depth <= 0 && GetWinner(root.result) == PLAYER_NONE && HasThreat(root.result)) {
+				return ScoreLeaf(root, alpha, beta, player, control);
+			}
 			return Heuristic(player, root.result);
 		}
+		// A win on the next swap needs no search
+		if (RowTables::WinningSwap(root.result, player, swapPos)) {
+			vertical = true;
+			return EVAL_WIN;
+		}
+		if (depth == 1) return NegamaxFrontier(root, alpha, beta, player, swapPos, vertical, control);
 		vector<Move*> nextMoves;
 		root.GetNextMoves(nextMoves);
 		int bestScore = -INT_MAX;
@@ -42,8 +206,9 @@ namespace AI {
 		for (Move* mv : nextMoves) {
 			int newSwapPos;
 			bool newVertical;
-			int newScore = -Negamax(*mv, depth - 1, -beta, -alpha, OtherPlayer(player), newSwapPos, newVertical);
-			if (newScore >= bestScore) {
+			int newScore = -Negamax(*mv, depth - 1, -beta, -alpha, OtherPlayer(player), newSwapPos, newVertical, control);
+			if (control && control->aborted) break;
+			if (newScore > bestScore) {
 				bestScore = newScore;
 				swapPos = mv->swapPos;
 				vertical = mv->vertical;
@@ -97,6 +262,7 @@ namespace AI {
 	void ComputeMove(
 		GameState currentState, const unordered_set<GameState>& seenStates, Player player,
 		int& swapPos, bool& vertical) {
+		PROFILE_SCOPE("AI::ComputeMove");
 		Move* rootMove = new Move();
 		rootMove->illegalStates = &seenStates;
 		rootMove->previous = nullptr;
@@ -104,4 +270,95 @@ namespace AI {
 		Negamax(*rootMove, DEPTH, -INT_MAX, INT_MAX, player, swapPos, vertical);
 		delete rootMove;
 	}
+	static const PositionDB* book = nullptr;
+	void SetBook(const PositionDB* db) {
+		book = db;
+	}
+	// Picks the legal move that scored best for the side to move in the
+	// recorded games
+	static bool BookMove(GameState s, const unordered_set<GameState>& seenStates, Player player,
+		int& swapPos, bool& vertical) {
+		PositionStats stats;
+		if (!book || !book->Lookup(s, player, stats) || stats.Games() < BOOK_MIN_GAMES) return false;
+		vector<MoveEntry> moves;
+		book->NextMoves(s, player, moves);
+		double bestScore = -1;
+		for (const MoveEntry& m : moves) {
+			int movePos;
+			bool moveVertical;
+			if (m.count < BOOK_MIN_MOVE_GAMES || !DecodeMove(m.move, movePos, moveVertical)) continue;
+			GameState next = PerformSwap(s, movePos, moveVertical);
+			PositionStats after;
+			if (next == s || seenStates.count(next) || !book->Lookup(next, OtherPlayer(player), after)) continue;
+			double score = 1 - after.Score();
+			if (score > bestScore) {
+				bestScore = score;
+				swapPos = movePos;
+				vertical = moveVertical;
+			}
+		}
+		return bestScore >= 0;
+	}
+	SearchInfo ComputeMove(
+		GameState currentState, const unordered_set<GameState>& seenStates, Player player,
+		TimeManager& time, int& swapPos, bool& vertical) {
+		PROFILE_SCOPE("AI::ComputeMove");
+		SearchInfo info;
+		if (BookMove(currentState, seenStates, player, swapPos, vertical)) {
+			info.book = true;
+			info.seconds = time.Elapsed();
+			return info;
+		}
+		Move root;
+		root.illegalStates = &seenStates;
+		root.result = currentState;
+		vector<Move*> moves;
+		root.GetNextMoves(moves);
+		swapPos = 0;
+		vertical = false;
+		if (!moves.empty()) {
+			swapPos = moves[0]->swapPos;
+			vertical = moves[0]->vertical;
+		}
+		// With one legal move there is nothing to think about
+		SearchControl control;
+		control.time = &time;
+		for (int depth = 1; moves.size() > 1 && depth <= MAX_SEARCH_DEPTH; depth++) {
+			// The first iteration always finishes, so there is always a move
+			SearchControl* limit = depth > 1 ? &control : nullptr;
+			int alpha = -INT_MAX;
+			size_t best = 0;
+			bool forced = false;
+			for (size_t i = 0; i < moves.size(); i++) {
+				int childSwapPos;
+				bool childVertical;
+				int score = -Negamax(*moves[i], depth - 1, -INT_MAX, -alpha, OtherPlayer(player),
+					childSwapPos, childVertical, limit);
+				if (control.aborted) break;
+				// Scores of moves that fail low are upper bounds, so this is still a proven loss
+				if (score <= -EVAL_WIN) forced = true;
+				if (score > alpha) {
+					alpha = score;
+					best = i;
+				}
+			}
+			if (control.aborted) break;
+			if (alpha >= EVAL_WIN) forced = true;
+			// The best move is searched first next time, so ties keep it
+			rotate(moves.begin(), moves.begin() + best, moves.begin() + best + 1);
+			swapPos = moves[0]->swapPos;
+			vertical = moves[0]->vertical;
+			info.depth = depth;
+			info.score = alpha;
+			// A decided game does not get any more decided by looking deeper
+			if (alpha >= EVAL_WIN || alpha <= -EVAL_WIN) break;
+			if (!time.NextIteration(alpha, best != 0, forced)) break;
+		}
+		for (Move* mv : moves) {
+			delete mv;
+		}
+		info.nodes = control.nodes;
+		info.seconds = time.Elapsed();
+		return info;
+	}
 }
\ No newline at end of file
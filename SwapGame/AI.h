@@ -1,7 +1,10 @@
 #pragma once
 #include <unordered_set>
 
+#include "Evaluation.h"
 #include "GameStates.h"
+#include "PositionDB.h"
+#include "TimeManager.h"
 
 using namespace std;
 
@@ -15,12 +18,54 @@ namespace AI {
 		bool IsIllegalState(GameState s) const;
 		void GetNextMoves(vector<Move*>& dest) const;
 	};
+	// Weights used by Heuristic; set them before starting a search
+	void SetWeights(const EvalWeights& w);
+	const EvalWeights& GetWeights();
+	// The weights folded into per-row tables
+	const EvalTables& GetTables();
+	// Whether leaves where a side is one swap from winning are searched
+	// further; on by default
+	void SetExtensions(bool enabled);
+	bool GetExtensions();
 	int Heuristic(Player p, GameState s);
-	int Negamax(const Move& root, int depth, int alpha, int beta, Player player, int& swapPos, bool& vertical);
+	// State shared by the nodes of a search. Once the time manager's hard
+	// limit passes, Negamax sets aborted and every node returns at once.
+	// Without a time manager it only counts nodes.
+	struct SearchControl {
+		const TimeManager* time = nullptr;
+		long long nodes = 0;
+		// Nodes searched by the threat extension past the nominal depth
+		long long extensionNodes = 0;
+		// Node count at which the clock is next read
+		long long nextCheck = 0;
+		bool aborted = false;
+	};
+	// Outcome of the last iteration a timed search completed
+	struct SearchInfo {
+		// The move came from the book rather than a search
+		bool book = false;
+		int depth = 0;
+		int score = 0;
+		long long nodes = 0;
+		double seconds = 0;
+	};
+	int Negamax(const Move& root, int depth, int alpha, int beta, Player player, int& swapPos, bool& vertical,
+		SearchControl* control = nullptr);
 	void ComputeMove(
 		GameState currentState,
 		const std::unordered_set<GameState>& seenStates,
 		Player player,
 		int& swapPos,
 		bool& vertical);
+	// Recorded games timed searches consult before searching; the database
+	// must outlive any search. Pass nullptr to stop using it.
+	void SetBook(const PositionDB* db);
+	// Deepens until the time manager says to stop
+	SearchInfo ComputeMove(
+		GameState currentState,
+		const std::unordered_set<GameState>& seenStates,
+		Player player,
+		TimeManager& time,
+		int& swapPos,
+		bool& vertical);
 }
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "Assets.h"
+
+#include <string>
+
+#include "Resource.h"
+#include "SDLError.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#endif
+
+using namespace std;
+
+namespace Assets {
+	const char* FileName(Asset a) {
+		switch (a) {
+		case ASSET_TEXTURE: return "SwapGameTex.png";
+		case ASSET_FONT: return "OpenSans_Bold.ttf";
+		default: return nullptr;
+		}
+	}
+
+#ifdef _WIN32
+	static int ResourceId(Asset a) {
+		switch (a) {
+		case ASSET_TEXTURE: return IDR_TEXTURE;
+		case ASSET_FONT: return IDR_FONT;
+		default: return 0;
+		}
+	}
+#endif
+
+	SDL_RWops* Open(Asset a) {
+#ifdef _WIN32
+		// Resource memory stays mapped for the lifetime of the process
+		HRSRC res = FindResource(nullptr, MAKEINTRESOURCE(ResourceId(a)), RT_RCDATA);
+		if (res) {
+			HGLOBAL data = LoadResource(nullptr, res);
+			DWORD size = SizeofResource(nullptr, res);
+			const void* bytes = data ? LockResource(data) : nullptr;
+			if (bytes && size) {
+				SDL_RWops* rw = SDL_RWFromConstMem(bytes, (int)size);
+				if (!rw) throw SDLError("SDL_RWFromConstMem");
+				return rw;
+			}
+		}
+#endif
+		string path;
+		char* base = SDL_GetBasePath();
+		if (base) {
+			path = base;
+			SDL_free(base);
+		}
+		path += FileName(a);
+		SDL_RWops* rw = SDL_RWFromFile(path.c_str(), "rb");
+		if (!rw) throw SDLError("SDL_RWFromFile");
+		return rw;
+	}
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <SDL.h>
+
+namespace Assets {
+	enum Asset { ASSET_TEXTURE, ASSET_FONT };
+	// Opens an asset compiled into the executable. Builds without embedded
+	// resources read the file from the executable's directory instead, so
+	// startup never depends on the working directory.
+	SDL_RWops* Open(Asset a);
+	const char* FileName(Asset a);
+}
@@ -2,7 +2,9 @@
 #include <memory>
 #include <cmath>
 #include <cstdint>
-#include <unordered_map>
+#include <cstring>
+#include <future>
+#include <vector>
 #include <unordered_set>
 
 #include <SDL.h>
@@ -15,109 +17,215 @@
 #include "TTFi.h"
 
 #include "AI.h"
+#include "Assets.h"
+#include "GameClock.h"
+#include "GameRecord.h"
 #include "GameStates.h"
 #include "MinMax.h"
 #include "NineSlice.h"
+#include "PositionDB.h"
+#include "Profiler.h"
+#include "SDLPtr.h"
+#include "SpriteBatch.h"
+#include "TextRenderer.h"
+#include "Tools.h"
+#include "Timing.h"
 
 // "Conversion, possible loss of data"
 #pragma warning(disable: 4244)
 
 using namespace std;
 
+// Fraction of the remaining swap distance covered every 1/ANIM_RATE seconds
 #define ANIM_SPEED 0.35f
-#define CPU_DELAY 10
+#define ANIM_RATE 60.0f
+#define CPU_DELAY_MS 170
 #define HIGHLIGHT_MARGIN 10
+#define WINDOW_WIDTH 800
+#define WINDOW_HEIGHT 480
+// Longest the loop sleeps without events when nothing is animating
+#define IDLE_TIMEOUT 1000
+#define FRAME_TIME 16
+// Time control for both players, in seconds
+#define CLOCK_BASE 180
+#define CLOCK_INCREMENT 2
+#define RECORD_FILE "games.swr"
+// Built from the record file with --build-index
+#define INDEX_FILE "games.swi"
+#define TRACE_FILE "trace.json"
 
 #define MAKE_RECT(VAR, X, Y, W, H) SDL_Rect VAR; VAR.x = X; VAR.y = Y; VAR.w = W; VAR.h = H
 #define MAKE_COLOR(VAR, R, G, B, A) SDL_Color VAR; VAR.r = R; VAR.g = G; VAR.b = B; VAR.a = A
 
-#define DECLARE_DELETER(c, d) struct c##_Deleter { void operator()(c* r) { if (r) d(r); } }
-
-DECLARE_DELETER(SDL_Renderer, SDL_DestroyRenderer);
-DECLARE_DELETER(SDL_Window, SDL_DestroyWindow);
-DECLARE_DELETER(SDL_Surface, SDL_FreeSurface);
-DECLARE_DELETER(SDL_Texture, SDL_DestroyTexture);
-DECLARE_DELETER(TTF_Font, TTF_CloseFont);
-
-#define SAFEPTR(x) unique_ptr<x, x##_Deleter>
-#define MAKESAFE(t, v) unique_ptr<t, t##_Deleter> v##_P(v)
+// Screen layout
+const SDL_Rect Rect_Window = { 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT };
+const SDL_Rect Rect_Status = { 480, 10, 320, 40 };
+const SDL_Rect Rect_WhiteLabel = { 490, 70, 150, 35 };
+const SDL_Rect Rect_WhiteButton = { 640, 70, 120, 35 };
+const SDL_Rect Rect_BlackLabel = { 490, 120, 150, 35 };
+const SDL_Rect Rect_BlackButton = { 640, 120, 120, 35 };
+const SDL_Rect Rect_WhiteClock = { 490, 165, 130, 30 };
+const SDL_Rect Rect_BlackClock = { 630, 165, 130, 30 };
+const SDL_Rect Rect_Restart = { 510, 210, 260, 40 };
+const SDL_Rect Rect_Book = { 480, 430, 320, 30 };
+
+struct AIMove {
+	int swapPos = 0;
+	bool vertical = false;
+};
 
 float lerp(float a, float b, float x) {
 	return a * (1 - x) + b * x;
 }
 
-SAFEPTR(SDL_Texture) StringTexture(
-	SDL_Renderer* renderer, TTF_Font* font, const char* text, SDL_Color c, SDL_Rect* bounds = nullptr) {
-	SDL_Surface* text_surf = TTF_RenderText_Blended(font, text, c);
-	if (!text_surf) throw SDLError("TTF_RenderText_Blended", TTF_GetError);
-	if (bounds) {
-		bounds->x = 0;
-		bounds->y = 0;
-		bounds->w = text_surf->w;
-		bounds->h = text_surf->h;
-	}
-	MAKESAFE(SDL_Surface, text_surf);
-	SDL_Texture* text_tex = SDL_CreateTextureFromSurface(renderer, text_surf);
-	if (!text_tex) throw SDLError("SDL_CreateTextureFromSurface");
-	return move(SAFEPTR(SDL_Texture)(text_tex));
+TextRenderer* textRenderer;
+SpriteBatch* textBatch;
+void CenterText(SDL_Rect r, const string& text) {
+	SDL_Rect strBounds;
+	textRenderer->Measure(text, &strBounds);
+	// Text wider or taller than the rect is cropped equally on both sides
+	int x = r.x + (r.w - strBounds.w) / 2;
+	int y = r.y + (r.h - strBounds.h) / 2;
+	textRenderer->Draw(*textBatch, text, x, y, &r);
 }
 
-SDL_Renderer* textRenderer;
-TTF_Font* textFont;
-SDL_Color textColor;
-unordered_map<string, SDL_Rect> stringBounds;
-unordered_map<string, SAFEPTR(SDL_Texture)> stringTextures;
-void RenderText(const string& s, SDL_Rect* bounds = nullptr, SDL_Texture** tex = nullptr) {
-	if (!stringBounds.count(s)) {
-#ifdef _DEBUG
-		cout << "Rendering text: '" << s.c_str() << "'" << endl;
-#endif
-		SDL_Rect newBounds;
-		stringTextures.emplace(s, StringTexture(textRenderer, textFont, s.c_str(), textColor, &newBounds));
-		stringBounds.emplace(s, newBounds);
+// Everything that ends up on screen, so consecutive frames can be compared
+// to find the regions that need redrawing
+struct View {
+	GameState state = 0;
+	bool swapping = false;
+	int swapPos = 0;
+	bool vertical = false;
+	float swapAnimation = 0;
+	bool highlight = false;
+	bool highlightLegal = false;
+	const char* status = "";
+	string whiteClock;
+	string blackClock;
+	Player clockRunning = PLAYER_NONE;
+	string book;
+	bool whiteIsAI = false;
+	bool blackIsAI = false;
+	bool showRestart = false;
+	bool hoverWhite = false;
+	bool hoverBlack = false;
+	bool hoverRestart = false;
+};
+
+SDL_Rect CellRect(int pos) {
+	MAKE_RECT(r, 0, 0, SQUARE_SIZE, SQUARE_SIZE);
+	GetScreenPos(pos, r.x, r.y);
+	return r;
+}
+
+SDL_Rect HighlightRect(int swapPos, bool vertical) {
+	const int shortSize = SQUARE_SIZE - 2 * HIGHLIGHT_MARGIN;
+	const int longSize = 2 * (SQUARE_SIZE - HIGHLIGHT_MARGIN);
+	SDL_Rect r;
+	GetScreenPos(swapPos, r.x, r.y);
+	r.x += HIGHLIGHT_MARGIN;
+	r.y += HIGHLIGHT_MARGIN;
+	r.w = vertical ? shortSize : longSize;
+	r.h = vertical ? longSize : shortSize;
+	return r;
+}
+
+// Area covered by both pieces of a swap, including every point in between
+SDL_Rect SwapRect(int swapPos, bool vertical) {
+	SDL_Rect a = CellRect(swapPos);
+	SDL_Rect b = CellRect(swapPos + (vertical ? BOARD_WIDTH : 1));
+	SDL_Rect r;
+	SDL_UnionRect(&a, &b, &r);
+	return r;
+}
+
+// Adds a rect to the dirty list, merging it with any rect it overlaps
+void AddDirty(vector<SDL_Rect>& dirty, SDL_Rect r) {
+	for (size_t i = 0; i < dirty.size(); i++) {
+		if (SDL_HasIntersection(&dirty[i], &r)) {
+			SDL_UnionRect(&dirty[i], &r, &r);
+			dirty.erase(dirty.begin() + i);
+			i = (size_t)-1;
+		}
 	}
-	if (bounds) *bounds = stringBounds[s];
-	if (tex) *tex = stringTextures[s].get();
+	dirty.push_back(r);
 }
 
-void CenterText(SDL_Renderer* renderer, SDL_Rect r, const string& text) {
-	SDL_Rect strBounds;
-	SDL_Texture* strTexture;
-	RenderText(text, &strBounds, &strTexture);
-	int ox = (strBounds.w - r.w) / 2;
-	int oy = (strBounds.h - r.h) / 2;
-	if (ox <= 0) {
-		r.w = strBounds.w;
-		r.x -= ox;
-	} else {
-		strBounds.w = r.w;
-		strBounds.x = ox;
+void DiffViews(const View& a, const View& b, vector<SDL_Rect>& dirty) {
+	GameState changed = a.state ^ b.state;
+	for (int i = 0; i < BOARD_CELLS; i++) {
+		if (changed & STATE_BIT(i)) AddDirty(dirty, CellRect(i));
 	}
-	if (oy <= 0) {
-		r.h = strBounds.h;
-		r.y -= oy;
-	} else {
-		strBounds.h = r.h;
-		strBounds.y = oy;
+	if (a.swapping != b.swapping || a.swapAnimation != b.swapAnimation ||
+		a.swapPos != b.swapPos || a.vertical != b.vertical) {
+		if (a.swapping) AddDirty(dirty, SwapRect(a.swapPos, a.vertical));
+		if (b.swapping) AddDirty(dirty, SwapRect(b.swapPos, b.vertical));
+	}
+	if (a.highlight != b.highlight || a.highlightLegal != b.highlightLegal ||
+		((a.highlight || b.highlight) && (a.swapPos != b.swapPos || a.vertical != b.vertical))) {
+		if (a.highlight) AddDirty(dirty, HighlightRect(a.swapPos, a.vertical));
+		if (b.highlight) AddDirty(dirty, HighlightRect(b.swapPos, b.vertical));
+	}
+	if (strcmp(a.status, b.status) != 0) AddDirty(dirty, Rect_Status);
+	if (a.whiteClock != b.whiteClock || (a.clockRunning == PLAYER_WHITE) != (b.clockRunning == PLAYER_WHITE)) {
+		AddDirty(dirty, Rect_WhiteClock);
+	}
+	if (a.blackClock != b.blackClock || (a.clockRunning == PLAYER_BLACK) != (b.clockRunning == PLAYER_BLACK)) {
+		AddDirty(dirty, Rect_BlackClock);
+	}
+	if (a.book != b.book) AddDirty(dirty, Rect_Book);
+	if (a.whiteIsAI != b.whiteIsAI || a.hoverWhite != b.hoverWhite) AddDirty(dirty, Rect_WhiteButton);
+	if (a.blackIsAI != b.blackIsAI || a.hoverBlack != b.hoverBlack) AddDirty(dirty, Rect_BlackButton);
+	if (a.showRestart != b.showRestart || a.hoverRestart != b.hoverRestart) AddDirty(dirty, Rect_Restart);
+}
+
+#ifdef SWAPGAME_PROFILE
+void DumpProfile(const string& dir, const Timing::FrameTimer& frameTimer) {
+	string path = dir + TRACE_FILE;
+	if (Profiler::WriteChromeTrace(path)) cout << "Wrote " << path << endl;
+	Profiler::PrintSummary(cout);
+	// The slowest of the recent frames, phase by phase
+	int recent = frameTimer.Frames() < FRAME_HISTORY ? frameTimer.Frames() : FRAME_HISTORY;
+	Timing::FrameTiming worst;
+	for (int i = 0; i < recent; i++) {
+		const Timing::FrameTiming& f = frameTimer.History(i);
+		if (f.Total() > worst.Total()) worst = f;
 	}
-	SDL_RenderCopy(renderer, strTexture, &strBounds, &r);
+	cout << frameTimer.Frames() << " frames, " << frameTimer.Hitches() << " over "
+		<< Timing::Milliseconds(HITCH_SECONDS) << " ms; slowest of the last " << recent << ": update "
+		<< Timing::Milliseconds(worst.update) << " ms, render " << Timing::Milliseconds(worst.render)
+		<< " ms, present " << Timing::Milliseconds(worst.present) << " ms" << endl;
 }
+#endif
 
 void SDLmain(int argc, char** argv)
 {
+	PROFILE_THREAD("Main");
 	// Boilerplate: Create window and renderer
 	SDL_Window* window = SDL_CreateWindow("Swap Game",
 		SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-		800, 480, 0);
+		WINDOW_WIDTH, WINDOW_HEIGHT, 0);
 	if (!window) throw SDLError("SDL_CreateWindow");
 	MAKESAFE(SDL_Window, window);
 	SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RendererFlags::SDL_RENDERER_PRESENTVSYNC);
 	if (!renderer) throw SDLError("SDL_CreateRenderer");
 	MAKESAFE(SDL_Renderer, renderer);
 
-	// Load texture from texture file
-	SDL_Surface* imgsurf = IMG_Load("SwapGameTex.png");
-	if (!imgsurf) throw SDLError("IMG_Load", IMG_GetError);
+	// The frame is kept in a texture so that only dirty regions need redrawing;
+	// without render-target support every redraw covers the whole window
+	SDL_Texture* frame = nullptr;
+	if (SDL_RenderTargetSupported(renderer)) {
+		frame = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+			WINDOW_WIDTH, WINDOW_HEIGHT);
+	}
+	MAKESAFE(SDL_Texture, frame);
+
+	// Load texture from the embedded texture file
+#ifdef _DEBUG
+	double loadStart = Timing::Now();
+#endif
+	SDL_Surface* imgsurf = IMG_Load_RW(Assets::Open(Assets::ASSET_TEXTURE), 1);
+	if (!imgsurf) throw SDLError("IMG_Load_RW", IMG_GetError);
 	MAKESAFE(SDL_Surface, imgsurf);
 	SDL_Texture* tex = SDL_CreateTextureFromSurface(renderer, imgsurf);
 	if (!tex) throw SDLError("SDL_CreateTextureFromSurface");
@@ -125,17 +233,18 @@ void SDLmain(int argc, char** argv)
 	imgsurf_P.release();
 
 	// Load font
-	TTF_Font* font = TTF_OpenFont("OpenSans_Bold.ttf", 20);
-	if (!font) throw SDLError("TTF_OpenFont", TTF_GetError);
+	TTF_Font* font = TTF_OpenFontRW(Assets::Open(Assets::ASSET_FONT), 1, 20);
+	if (!font) throw SDLError("TTF_OpenFontRW", TTF_GetError);
 	MAKESAFE(TTF_Font, font);
-
-	// Declare colors
-	MAKE_COLOR(Color_White, 255, 255, 255, SDL_ALPHA_OPAQUE);
+#ifdef _DEBUG
+	cout << "Assets loaded in " << Timing::Milliseconds(Timing::Now() - loadStart) << " ms" << endl;
+#endif
 
 	// Initialize text rendering
-	textRenderer = renderer;
-	textFont = font;
-	textColor = Color_White;
+	SpriteBatch batch(renderer);
+	TextRenderer text(renderer, font);
+	textRenderer = &text;
+	textBatch = &batch;
 
 	// Texture-map coordinates
 	MAKE_RECT(Rect_Black, 0, 0, 80, 80);
@@ -152,6 +261,9 @@ void SDLmain(int argc, char** argv)
 	// SDL event-loop variables
 	bool running = true;
 	SDL_Event ev;
+	// Finished searches post this event so an idle loop wakes up immediately
+	const Uint32 searchDoneEvent = SDL_RegisterEvents(1);
+	if (searchDoneEvent == (Uint32)-1) throw SDLError("SDL_RegisterEvents");
 	// Game variables
 	const GameState startState = (1LL << (BOARD_HEIGHT / 2 * BOARD_WIDTH)) - 1;
 	GameState displayState = startState;
@@ -160,12 +272,19 @@ void SDLmain(int argc, char** argv)
 	float swapAnim2 = 0;
 	bool swapping = false;
 	bool vertical = false;
-	int AITimer = CPU_DELAY;
+	double AIReadyTime = Timing::Now() + CPU_DELAY_MS / 1000.0;
+	bool searching = false;
+	future<AIMove> search;
+	shared_ptr<TimeManager> searchTime;
 	int swapPos = 0;
-	int mouseX = 0, mouseY = 0;
+	int mouseX = -1, mouseY = -1;
 	bool mouseClicked;
 	Player currentPlayer = PLAYER_WHITE;
 	Player winner = PLAYER_NONE;
+	bool lostOnTime = false;
+	// Each side's clock starts when it can move: at once for a player, and
+	// only once the search begins for the CPU
+	GameClock clock(CLOCK_BASE, CLOCK_INCREMENT);
 	GameState finalState = displayState;
 	unordered_set<GameState> seenStates;
 	seenStates.insert(displayState);
@@ -173,221 +292,449 @@ void SDLmain(int argc, char** argv)
 	bool whiteIsAI = false;
 	bool blackIsAI = true;
 
-	// Main loop
-	while (running) {
-		// Handle events
-		mouseClicked = false;
-		while (SDL_PollEvent(&ev)) {
-			switch (ev.type) {
-			case SDL_QUIT: running = false; break;
-
-			case SDL_MOUSEMOTION:
-				mouseX = ev.motion.x;
-				mouseY = ev.motion.y;
-				break;
-
-			case SDL_MOUSEBUTTONDOWN:
-				if (ev.button.button == 1) {
-					mouseClicked = true;
-					mouseX = ev.button.x;
-					mouseY = ev.button.y;
-				}
-				break;
+	// Every game is appended to a record file in the user's preference directory
+	unique_ptr<GameRecordWriter> recorder;
+	string prefDir;
+	char* prefPath = SDL_GetPrefPath("id523", "SwapGame");
+	if (prefPath) {
+		prefDir = prefPath;
+		SDL_free(prefPath);
+		try {
+			recorder = make_unique<GameRecordWriter>(prefDir + RECORD_FILE);
+		} catch (RecordError& ex) {
+			cout << ex.what() << endl;
+		}
+	}
+	// An index of the recorded games, if one has been built, serves as the
+	// CPU's opening book and shows how the current position has fared
+	unique_ptr<PositionDB> positionDB;
+	string bookText;
+	if (!prefDir.empty()) {
+		string indexPath = prefDir + INDEX_FILE;
+		if (SDL_RWops* probe = SDL_RWFromFile(indexPath.c_str(), "rb")) {
+			SDL_RWclose(probe);
+			try {
+				positionDB = make_unique<PositionDB>(indexPath);
+				AI::SetBook(positionDB.get());
+			} catch (RecordError& ex) {
+				// Say so on screen rather than just playing without the book
+				cout << ex.what() << endl;
+				bookText = "Game index could not be opened";
 			}
 		}
-		// Draw board on screen
-		SDL_SetRenderDrawColor(renderer, 64, 64, 64, 255);
-		SDL_RenderClear(renderer);
+	}
+	GameState bookState = 0;
+	Player bookPlayer = PLAYER_NONE;
+
+	GameRecord gameRecord;
+	gameRecord.start = startState;
+	gameRecord.firstPlayer = currentPlayer;
+	auto saveGame = [&]() {
+		if (recorder && !gameRecord.moves.empty()) {
+			gameRecord.winner = winner;
+			gameRecord.onTime = lostOnTime;
+			try {
+				recorder->Write(gameRecord);
+				recorder->Flush();
+			} catch (RecordError& ex) {
+				cout << ex.what() << endl;
+			}
+		}
+		gameRecord.moves.clear();
+		gameRecord.whiteIsAI = false;
+		gameRecord.blackIsAI = false;
+	};
+
+	// Redraw state
+	View shown;
+	bool fullRedraw = true;
+	bool presented = false;
+	Timing::FrameTimer frameTimer;
+	vector<SDL_Rect> dirty;
+
+	auto handleEvent = [&](const SDL_Event& e) {
+		switch (e.type) {
+		case SDL_QUIT: running = false; break;
+
+		case SDL_MOUSEMOTION:
+			mouseX = e.motion.x;
+			mouseY = e.motion.y;
+			break;
+
+		case SDL_MOUSEBUTTONDOWN:
+			if (e.button.button == 1) {
+				mouseClicked = true;
+				mouseX = e.button.x;
+				mouseY = e.button.y;
+			}
+			break;
+
+		case SDL_WINDOWEVENT:
+			if (e.window.event == SDL_WINDOWEVENT_EXPOSED) {
+				fullRedraw = true;
+			} else if (e.window.event == SDL_WINDOWEVENT_LEAVE) {
+				// Drop any hover highlight once the mouse leaves the window
+				mouseX = -1;
+				mouseY = -1;
+			}
+			break;
+
+		case SDL_RENDER_TARGETS_RESET:
+			fullRedraw = true;
+			break;
+
+#ifdef SWAPGAME_PROFILE
+		case SDL_KEYDOWN:
+			// Dump what led up to a stall while it is still in the buffers
+			if (e.key.keysym.sym == SDLK_F12 && !e.key.repeat) DumpProfile(prefDir, frameTimer);
+			break;
+#endif
+		}
+	};
+
+	auto isAI = [&](Player p) {
+		return p == PLAYER_BLACK ? blackIsAI : whiteIsAI;
+	};
+
+	// Draws the whole view; callers restrict the output with the batch's clip rect
+	auto render = [&](const View& v) {
 		SDL_Rect dest = Rect_Board;
 		dest.x = START_X;
 		dest.y = START_Y;
-		SDL_RenderCopy(renderer, tex, &Rect_Board, &dest);
+		batch.Draw(tex, &Rect_Board, &dest);
 
 		// Draw pieces on screen
 		dest = Rect_Black;
 		int x1, y1, x2, y2;
-		int swapPos2 = swapPos + (vertical ? BOARD_WIDTH : 1);
+		int swapPos2 = v.swapPos + (v.vertical ? BOARD_WIDTH : 1);
 		// Compute destination positions for pieces being swapped
-		GetScreenPos(swapPos, x1, y1);
+		GetScreenPos(v.swapPos, x1, y1);
 		GetScreenPos(swapPos2, x2, y2);
 		for (int i = 0; i < BOARD_CELLS; i++) {
 			// If the piece is being swapped, compute its screen position with interpolation
-			if (i == swapPos) {
-				dest.x = (int)(0.5f + lerp(x1, x2, swapAnimation));
-				dest.y = (int)(0.5f + lerp(y1, y2, swapAnimation));
+			if (i == v.swapPos) {
+				dest.x = (int)(0.5f + lerp(x1, x2, v.swapAnimation));
+				dest.y = (int)(0.5f + lerp(y1, y2, v.swapAnimation));
 			} else if (i == swapPos2) {
-				dest.x = (int)(0.5f + lerp(x2, x1, swapAnimation));
-				dest.y = (int)(0.5f + lerp(y2, y1, swapAnimation));
+				dest.x = (int)(0.5f + lerp(x2, x1, v.swapAnimation));
+				dest.y = (int)(0.5f + lerp(y2, y1, v.swapAnimation));
 			} else {
 				// Otherwise compute it directly
 				GetScreenPos(i, dest.x, dest.y);
 			}
 			// Draw the piece
-			SDL_RenderCopy(renderer, tex,
-				(displayState & STATE_BIT(i)) ? &Rect_White : &Rect_Black,
+			batch.Draw(tex,
+				(v.state & STATE_BIT(i)) ? &Rect_White : &Rect_Black,
 				&dest);
 		}
 
+		// Draw the highlight in the correct colour, corresponding to the legality of the move
+		if (v.highlight) {
+			const NineSlice* Highlight = v.highlightLegal ? HighlightLegal.get() : HighlightIllegal.get();
+			dest = HighlightRect(v.swapPos, v.vertical);
+			Highlight->Draw(batch, &dest);
+		}
+
+		// Write status text
+		CenterText(Rect_Status, v.status);
+
+		// Draw selectors for white and black
+		const SDL_Rect* buttons[] = { &Rect_WhiteButton, &Rect_BlackButton, &Rect_Restart };
+		const SDL_Rect* labels[] = { &Rect_WhiteLabel, &Rect_BlackLabel, nullptr };
+		const char* labelText[] = { "White player:", "Black player:", nullptr };
+		const char* buttonText[] = {
+			v.whiteIsAI ? "CPU" : "Manual",
+			v.blackIsAI ? "CPU" : "Manual",
+			"Restart Game" };
+		const bool hover[] = { v.hoverWhite, v.hoverBlack, v.hoverRestart };
+		const int buttonCount = v.showRestart ? 3 : 2;
+		for (int i = 0; i < buttonCount; i++) {
+			if (labels[i]) CenterText(*labels[i], labelText[i]);
+			if (hover[i]) {
+				batch.SetColor(0, 48, 128);
+			} else {
+				batch.SetColor(0, 16, 64);
+			}
+			RoundedBG->Draw(batch, buttons[i]);
+			batch.SetColor(255, 255, 255);
+			RoundedFGRidge->Draw(batch, buttons[i]);
+			CenterText(*buttons[i], buttonText[i]);
+		}
+
+		CenterText(Rect_Book, v.book);
+
+		// Draw the clocks, lighting up the one that is running
+		const SDL_Rect* clockRects[] = { &Rect_WhiteClock, &Rect_BlackClock };
+		const string clockText[] = { "White " + v.whiteClock, "Black " + v.blackClock };
+		const Player clockPlayers[] = { PLAYER_WHITE, PLAYER_BLACK };
+		for (int i = 0; i < 2; i++) {
+			if (v.clockRunning == clockPlayers[i]) {
+				batch.SetColor(0, 48, 128);
+			} else {
+				batch.SetColor(0, 16, 64);
+			}
+			RoundedBG->Draw(batch, clockRects[i]);
+			batch.SetColor(255, 255, 255);
+			CenterText(*clockRects[i], clockText[i]);
+		}
+	};
+
+	// Main loop
+	while (running) {
+		// Handle events, sleeping until one arrives when nothing is moving
+		mouseClicked = false;
+		bool AIDelay = winner == PLAYER_NONE && !swapping && !searching && isAI(currentPlayer);
+		bool animating = swapping;
+		if (!fullRedraw && (!animating || !presented)) {
+			// Vsync paces frames that present; anything else waits out a frame itself
+			int timeout = animating ? FRAME_TIME : IDLE_TIMEOUT;
+			if (AIDelay) {
+				double remaining = Timing::Milliseconds(AIReadyTime - Timing::Now());
+				timeout = Max(0, Min(timeout, (int)ceil(remaining)));
+			}
+			// Wake up when the running clock's display changes
+			if (clock.Running() != PLAYER_NONE) {
+				double untilTick = Timing::Milliseconds(clock.UntilDisplayChange(clock.Running()));
+				timeout = Max(0, Min(timeout, (int)ceil(untilTick)));
+			}
+			if (SDL_WaitEventTimeout(&ev, timeout)) handleEvent(ev);
+		}
+		while (SDL_PollEvent(&ev)) handleEvent(ev);
+		if (!running) break;
+		PROFILE_SCOPE("Frame");
+		frameTimer.Begin();
+
+		SDL_Point mouse;
+		mouse.x = mouseX;
+		mouse.y = mouseY;
+		View view;
+
+		// A player whose time runs out before committing to a move loses
+		if (winner == PLAYER_NONE && !swapping && clock.Flagged() != PLAYER_NONE) {
+			winner = OtherPlayer(clock.Flagged());
+			lostOnTime = true;
+			clock.Stop();
+			saveGame();
+		}
+
 		// Handle game mechanics
 		if (swapping) {
 			// If a swap is in progress, update the animation
-			swapAnim2 = lerp(swapAnim2, 1, ANIM_SPEED);
-			swapAnimation = lerp(swapAnimation, swapAnim2, ANIM_SPEED);
+			float step = 1 - pow(1 - ANIM_SPEED, (float)frameTimer.Delta() * ANIM_RATE);
+			swapAnim2 = lerp(swapAnim2, 1, step);
+			swapAnimation = lerp(swapAnimation, swapAnim2, step);
 			if (swapAnimation > endSwapAnimation) {
 				// If the animation is finished, reset all of the swap-display variables
 				swapping = false;
 				swapAnimation = 0.0f;
 				swapAnim2 = 0.0f;
-				AITimer = CPU_DELAY;
+				AIReadyTime = Timing::Now() + CPU_DELAY_MS / 1000.0;
 				// Compute the new state of the board
 				displayState = finalState;
 				seenStates.insert(displayState);
+				// Record the move
+				gameRecord.moves.push_back(EncodeMove(swapPos, vertical));
+				if (isAI(currentPlayer)) {
+					if (currentPlayer == PLAYER_BLACK) gameRecord.blackIsAI = true;
+					else gameRecord.whiteIsAI = true;
+				}
 				// Check if either side has won
 				winner = GetWinner(displayState);
+				if (winner) saveGame();
 				// Set next player
 				currentPlayer = OtherPlayer(currentPlayer);
 			}
 		} else if (winner == 0) {
 			// If a game is in progress, and the current player is human,
-			if ((currentPlayer == PLAYER_BLACK && !blackIsAI) || (currentPlayer == PLAYER_WHITE && !whiteIsAI)) {
+			if (!isAI(currentPlayer)) {
+				if (clock.Running() != currentPlayer) clock.Start(currentPlayer);
 				// compute the swap corresponding to the current position of the mouse
 				if (GetMoveFromPos(mouseX, mouseY, swapPos, vertical)) {
 					// Work out what state the swap will result in, and whether it is legal
 					finalState = PerformSwap(displayState, swapPos, vertical);
 					bool legalMove = !seenStates.count(finalState);
-
-					// Draw the highlight in the correct colour, corresponding to the legality of the move
-					const NineSlice* Highlight = legalMove ? HighlightLegal.get() : HighlightIllegal.get();
-					int hX, hY;
-					const int shortSize = SQUARE_SIZE - 2 * HIGHLIGHT_MARGIN;
-					const int longSize = 2 * (SQUARE_SIZE - HIGHLIGHT_MARGIN);
-					GetScreenPos(swapPos, hX, hY);
-					Highlight->RenderRect(renderer,
-						hX + HIGHLIGHT_MARGIN, hY + HIGHLIGHT_MARGIN,
-						vertical ? shortSize : longSize,
-						vertical ? longSize : shortSize);
+					view.highlight = true;
+					view.highlightLegal = legalMove;
 
 					if (mouseClicked && legalMove) {
 						// If the user clicked the mouse, begin carrying out the move
 						swapping = true;
+						clock.Stop();
+						view.highlight = false;
 					}
 				}
-			} else {
-				// A game is in progress and the current player is an AI
-				if (AITimer > 0) {
-					// The AI is waiting to move
-					AITimer -= 1;
-				} else {
-					// The AI is ready to move
-					// TODO: Set swapPos and vertical to the AI's move
-					AI::ComputeMove(displayState, seenStates, currentPlayer, swapPos, vertical);
+			} else if (searching) {
+				// The AI is thinking on another thread
+				if (search.wait_for(chrono::seconds(0)) == future_status::ready) {
+					AIMove mv = search.get();
+					searching = false;
+					swapPos = mv.swapPos;
+					vertical = mv.vertical;
 					finalState = PerformSwap(displayState, swapPos, vertical);
 					swapping = true;
+					clock.Stop();
 				}
+			} else if (Timing::Now() < AIReadyTime) {
+				// The AI is waiting to move
+			} else {
+				// The AI is ready to move
+				searching = true;
+				GameState state = displayState;
+				unordered_set<GameState> seen = seenStates;
+				Player player = currentPlayer;
+				if (clock.Running() != player) clock.Start(player);
+				shared_ptr<TimeManager> time = make_shared<TimeManager>(clock.Remaining(player), clock.Increment());
+				searchTime = time;
+				search = async(launch::async, [=]() {
+					PROFILE_THREAD("Search");
+					AIMove mv;
+					AI::SearchInfo info = AI::ComputeMove(state, seen, player, *time, mv.swapPos, mv.vertical);
+#ifdef _DEBUG
+					if (info.book) {
+						cout << "Played a book move" << endl;
+					} else {
+						cout << "Searched depth " << info.depth << " (score " << info.score << ", "
+							<< info.nodes << " nodes) in " << Timing::Milliseconds(info.seconds) << " ms" << endl;
+					}
+#endif
+					SDL_Event done;
+					SDL_zero(done);
+					done.type = searchDoneEvent;
+					SDL_PushEvent(&done);
+					return mv;
+				});
 			}
-		} else {
-			// If there has been a winner
+		}
+		if (searching && (winner || !isAI(currentPlayer))) {
+			// The player was switched to manual or lost on time mid-search;
+			// the result is no longer wanted
+			searchTime->Stop();
+			search.wait();
+			searching = false;
 		}
 
-		// Write status text
-		const char* statusText = nullptr;
+		// Status text
 		if (winner == PLAYER_BLACK) {
-			statusText = "Black wins!";
+			view.status = lostOnTime ? "Black wins on time!" : "Black wins!";
 		} else if (winner == PLAYER_WHITE) {
-			statusText = "White wins!";
+			view.status = lostOnTime ? "White wins on time!" : "White wins!";
 		} else if (currentPlayer == PLAYER_BLACK) {
-			statusText = "Black's turn to move.";
+			view.status = "Black's turn to move.";
 		} else {
-			statusText = "White's turn to move.";
+			view.status = "White's turn to move.";
 		}
-		dest.x = 480;
-		dest.y = 10;
-		dest.w = 320;
-		dest.h = 40;
-		CenterText(renderer, dest, statusText);
 
-		// Show controls for player/CPU
-		SDL_Point mouse;
-		mouse.x = mouseX;
-		mouse.y = mouseY;
-		bool mouseHover = false;
-
-		// Draw selector for white
-		dest.x = 490;
-		dest.y = 70;
-		dest.w = 150;
-		dest.h = 35;
-		CenterText(renderer, dest, "White player:");
-		dest.x = 640;
-		dest.w = 120;
-		mouseHover = !!SDL_PointInRect(&mouse, &dest);
-		if (mouseHover) {
-			SDL_SetTextureColorMod(tex, 0, 48, 128);
-		} else {
-			SDL_SetTextureColorMod(tex, 0, 16, 64);
-		}
-		RoundedBG->RenderRect(renderer, &dest);
-		SDL_SetTextureColorMod(tex, 255, 255, 255);
-		RoundedFGRidge->RenderRect(renderer, &dest);
-		CenterText(renderer, dest, whiteIsAI ? "CPU" : "Manual");
-		if (mouseClicked && mouseHover) {
+		// Controls for player/CPU
+		view.hoverWhite = !!SDL_PointInRect(&mouse, &Rect_WhiteButton);
+		if (mouseClicked && view.hoverWhite) {
 			whiteIsAI = !whiteIsAI;
 		}
-
-		// Draw selector for black
-		dest.x = 490;
-		dest.y = 120;
-		dest.w = 150;
-		dest.h = 35;
-		CenterText(renderer, dest, "Black player:");
-		dest.x = 640;
-		dest.w = 120;
-		mouseHover = !!SDL_PointInRect(&mouse, &dest);
-		if (mouseHover) {
-			SDL_SetTextureColorMod(tex, 0, 48, 128);
-		} else {
-			SDL_SetTextureColorMod(tex, 0, 16, 64);
-		}
-		RoundedBG->RenderRect(renderer, &dest);
-		SDL_SetTextureColorMod(tex, 255, 255, 255);
-		RoundedFGRidge->RenderRect(renderer, &dest);
-		CenterText(renderer, dest, blackIsAI ? "CPU" : "Manual");
-		if (mouseClicked && mouseHover) {
+		view.hoverBlack = !!SDL_PointInRect(&mouse, &Rect_BlackButton);
+		if (mouseClicked && view.hoverBlack) {
 			blackIsAI = !blackIsAI;
 		}
 
-		// Draw restart-game button
+		// Restart-game button
 		if (winner) {
-			dest.x = 510;
-			dest.y = 200;
-			dest.w = 260;
-			dest.h = 40;
-			mouseHover = !!SDL_PointInRect(&mouse, &dest);
-			if (mouseHover) {
-				SDL_SetTextureColorMod(tex, 0, 48, 128);
-			} else {
-				SDL_SetTextureColorMod(tex, 0, 16, 64);
-			}
-			RoundedBG->RenderRect(renderer, &dest);
-			SDL_SetTextureColorMod(tex, 255, 255, 255);
-			RoundedFGRidge->RenderRect(renderer, &dest);
-			CenterText(renderer, dest, "Restart Game");
-			if (mouseClicked && mouseHover) {
+			view.showRestart = true;
+			view.hoverRestart = !!SDL_PointInRect(&mouse, &Rect_Restart);
+			if (mouseClicked && view.hoverRestart) {
 				winner = PLAYER_NONE;
 				displayState = startState;
 				currentPlayer = PLAYER_WHITE;
+				lostOnTime = false;
+				clock.Reset();
+				AIReadyTime = Timing::Now() + CPU_DELAY_MS / 1000.0;
 				seenStates.clear();
 				seenStates.insert(startState);
+				gameRecord.start = startState;
+				gameRecord.firstPlayer = currentPlayer;
+				view.showRestart = false;
 			}
 		}
 
-		// Update the screen
-		SDL_RenderPresent(renderer);
+		view.state = displayState;
+		view.swapping = swapping;
+		view.swapPos = swapPos;
+		view.vertical = vertical;
+		view.swapAnimation = swapAnimation;
+		view.whiteIsAI = whiteIsAI;
+		view.blackIsAI = blackIsAI;
+		view.whiteClock = GameClock::Format(clock.Remaining(PLAYER_WHITE));
+		view.blackClock = GameClock::Format(clock.Remaining(PLAYER_BLACK));
+		view.clockRunning = clock.Running();
+		if (positionDB && (displayState != bookState || currentPlayer != bookPlayer)) {
+			bookState = displayState;
+			bookPlayer = currentPlayer;
+			PositionStats stats;
+			if (positionDB->Lookup(bookState, bookPlayer, stats)) {
+				bookText = "Seen in " + to_string(stats.Games()) + " games, " +
+					to_string((int)lround(stats.Score() * 100)) + "% for mover";
+			} else {
+				bookText = "Position not in the records";
+			}
+		}
+		view.book = bookText;
+
+		// Work out which parts of the window changed
+		dirty.clear();
+		if (!fullRedraw) DiffViews(shown, view, dirty);
+		// Without a persistent frame texture the back buffer has to be redrawn in full
+		if (fullRedraw || (!frame && !dirty.empty())) {
+			dirty.clear();
+			dirty.push_back(Rect_Window);
+		}
+		fullRedraw = false;
+		shown = view;
+		frameTimer.EndUpdate();
+		presented = !dirty.empty();
+		if (!presented) {
+			frameTimer.EndFrame();
+			continue;
+		}
+
+		// Redraw the dirty regions into the frame, then update the screen
+		{
+			PROFILE_SCOPE("Render");
+			SDL_SetRenderTarget(renderer, frame);
+			SDL_SetRenderDrawColor(renderer, 64, 64, 64, 255);
+			for (const SDL_Rect& r : dirty) {
+				// Only quads touching the rect are queued
+				batch.SetClipRect(&r);
+				SDL_RenderFillRect(renderer, &r);
+				render(view);
+				batch.Flush();
+			}
+			batch.SetClipRect(nullptr);
+			if (frame) {
+				SDL_SetRenderTarget(renderer, nullptr);
+				SDL_RenderCopy(renderer, frame, nullptr, nullptr);
+			}
+		}
+		frameTimer.EndRender();
+		{
+			PROFILE_SCOPE("SDL_RenderPresent");
+			SDL_RenderPresent(renderer);
+		}
+		frameTimer.EndPresent();
+	}
+	if (searching) {
+		searchTime->Stop();
+		search.wait();
 	}
+	AI::SetBook(nullptr);
+	// Keep unfinished games too
+	saveGame();
+#ifdef SWAPGAME_PROFILE
+	DumpProfile(prefDir, frameTimer);
+#endif
 }
 
 int main(int argc, char** argv)
 {
+	// Command-line tools don't need a window
+	int toolResult = RunTool(argc, argv);
+	if (toolResult >= 0) return toolResult;
 	try
 	{
 		SDLi sdli; // Initialize SDL
@@ -0,0 +1,106 @@
+#include "Evaluation.h"
+
+#include "TunedWeights.h"
+
+using namespace RowTables;
+
+static_assert(sizeof(TunedWeights) / sizeof(TunedWeights[0]) == FEATURE_COUNT,
+	"TunedWeights.h does not match the evaluation features; regenerate it");
+
+namespace Eval {
+	static EvalWeights LoadDefaultWeights() {
+		EvalWeights weights;
+		for (int i = 0; i < FEATURE_COUNT; i++) weights.w[i] = TunedWeights[i];
+		return weights;
+	}
+
+	const EvalWeights& DefaultWeights() {
+		static const EvalWeights weights = LoadDefaultWeights();
+		return weights;
+	}
+
+	const char* FeatureName(int f) {
+		static const char* rowNames[] = {
+			"Row 0 white", "Row 1 white", "Row 2 white", "Row 3 white",
+			"Row 4 white", "Row 5 white", "Row 6 white", "Row 7 white" };
+		static_assert(BOARD_HEIGHT <= sizeof(rowNames) / sizeof(rowNames[0]), "Add names for the extra rows");
+		if (f >= FEATURE_ROW_WHITE && f < FEATURE_ROW_WHITE + BOARD_HEIGHT) return rowNames[f - FEATURE_ROW_WHITE];
+		switch (f) {
+		case FEATURE_BLACK_NEAR_WIN: return "Black near win";
+		case FEATURE_WHITE_NEAR_WIN: return "White near win";
+		case FEATURE_WHITE_PAIRS: return "White pairs";
+		case FEATURE_BLACK_PAIRS: return "Black pairs";
+		case FEATURE_BLACK_ONE_SWAP: return "Black one swap from goal";
+		case FEATURE_WHITE_ONE_SWAP: return "White one swap from goal";
+		case FEATURE_BLACK_WINS_NEXT: return "Black wins next";
+		case FEATURE_WHITE_WINS_NEXT: return "White wins next";
+		default: return "";
+		}
+	}
+
+	// Features that depend on a single row
+	static void AddRowFeatures(int y, unsigned row, int* features) {
+		int count = WhiteCount[row];
+		features[FEATURE_ROW_WHITE + y] += count;
+		features[FEATURE_WHITE_PAIRS] += WhitePairCount[row];
+		features[FEATURE_BLACK_PAIRS] += BlackPairCount[row];
+		if (y == 0) features[FEATURE_BLACK_NEAR_WIN] += count == 1;
+		if (y == BOARD_HEIGHT - 1) features[FEATURE_WHITE_NEAR_WIN] += count == BOARD_WIDTH - 1;
+	}
+
+	// Features of the goal rows together with their neighbours
+	static void AddTopFeatures(unsigned pair, int* features) {
+		features[FEATURE_BLACK_ONE_SWAP] += BlackOneSwapCount[pair];
+		features[FEATURE_BLACK_WINS_NEXT] += BlackWinColumn[pair] >= 0;
+	}
+	static void AddBottomFeatures(unsigned pair, int* features) {
+		features[FEATURE_WHITE_ONE_SWAP] += WhiteOneSwapCount[pair];
+		features[FEATURE_WHITE_WINS_NEXT] += WhiteWinColumn[pair] >= 0;
+	}
+
+	void GetFeatures(GameState s, int* features) {
+		for (int f = 0; f < FEATURE_COUNT; f++) features[f] = 0;
+		for (int y = 0; y < BOARD_HEIGHT; y++) AddRowFeatures(y, Row(s, y), features);
+		AddTopFeatures(TopPair(s), features);
+		AddBottomFeatures(BottomPair(s), features);
+	}
+
+	static int Dot(const EvalWeights& weights, const int* features) {
+		int result = 0;
+		for (int i = 0; i < FEATURE_COUNT; i++) {
+			result += weights.w[i] * features[i];
+		}
+		return result;
+	}
+
+	int Evaluate(const EvalWeights& weights, GameState s) {
+		int features[FEATURE_COUNT];
+		GetFeatures(s, features);
+		return Dot(weights, features);
+	}
+
+	void BuildTables(const EvalWeights& weights, EvalTables& tables) {
+		int features[FEATURE_COUNT];
+		for (unsigned pair = 0; pair < ROW_PAIR_PATTERNS; pair++) {
+			unsigned edge = pair & ROW_BITS;
+			unsigned next = pair >> BOARD_WIDTH;
+			for (int f = 0; f < FEATURE_COUNT; f++) features[f] = 0;
+			AddRowFeatures(0, edge, features);
+			AddRowFeatures(1, next, features);
+			AddTopFeatures(pair, features);
+			tables.top[pair] = Dot(weights, features);
+			for (int f = 0; f < FEATURE_COUNT; f++) features[f] = 0;
+			AddRowFeatures(BOARD_HEIGHT - 1, edge, features);
+			AddRowFeatures(BOARD_HEIGHT - 2, next, features);
+			AddBottomFeatures(pair, features);
+			tables.bottom[pair] = Dot(weights, features);
+		}
+		for (int y = 0; y < BOARD_HEIGHT; y++) {
+			for (unsigned row = 0; row < ROW_PATTERNS; row++) {
+				for (int f = 0; f < FEATURE_COUNT; f++) features[f] = 0;
+				AddRowFeatures(y, row, features);
+				tables.middle[y][row] = Dot(weights, features);
+			}
+		}
+	}
+}
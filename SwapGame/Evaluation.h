@@ -0,0 +1,60 @@
+#pragma once
+#include "GameStates.h"
+#include "RowTables.h"
+
+// Score of a won position, beyond the reach of any heuristic score
+#define EVAL_WIN 1000000
+// Weights are stored in hundredths of a piece
+#define EVAL_SCALE 100
+
+// Features are measured on the board as it stands; evaluation combines them
+// from black's point of view.
+enum EvalFeature {
+	// Number of white pieces in each row, top row first
+	FEATURE_ROW_WHITE = 0,
+	// The top row holds a single white piece
+	FEATURE_BLACK_NEAR_WIN = FEATURE_ROW_WHITE + BOARD_HEIGHT,
+	// The bottom row is missing a single white piece
+	FEATURE_WHITE_NEAR_WIN,
+	// Adjacent pairs of one colour within a row, over the whole board
+	FEATURE_WHITE_PAIRS,
+	FEATURE_BLACK_PAIRS,
+	// Pieces one vertical swap from taking a cell of their goal row
+	FEATURE_BLACK_ONE_SWAP,
+	FEATURE_WHITE_ONE_SWAP,
+	// One swap wins the game
+	FEATURE_BLACK_WINS_NEXT,
+	FEATURE_WHITE_WINS_NEXT,
+	FEATURE_COUNT
+};
+
+struct EvalWeights {
+	int w[FEATURE_COUNT];
+};
+
+// Weights folded into a score per row pattern, so evaluating is one lookup
+// per row. The two goal rows are looked up together with their neighbours.
+struct EvalTables {
+	// Rows 0 and 1, indexed by RowTables::TopPair
+	int top[ROW_PAIR_PATTERNS];
+	// Rows BOARD_HEIGHT - 1 and BOARD_HEIGHT - 2, indexed by RowTables::BottomPair
+	int bottom[ROW_PAIR_PATTERNS];
+	// Rows 2 to BOARD_HEIGHT - 3, indexed by row number then RowTables::Row
+	int middle[BOARD_HEIGHT][ROW_PATTERNS];
+};
+
+namespace Eval {
+	// Weights compiled in from TunedWeights.h
+	const EvalWeights& DefaultWeights();
+	const char* FeatureName(int f);
+	void GetFeatures(GameState s, int* features);
+	// Heuristic score for black, ignoring whether the game is over
+	int Evaluate(const EvalWeights& weights, GameState s);
+	void BuildTables(const EvalWeights& weights, EvalTables& tables);
+	// Same as Evaluate with the weights the tables were built from
+	inline int Evaluate(const EvalTables& tables, GameState s) {
+		int result = tables.top[RowTables::TopPair(s)] + tables.bottom[RowTables::BottomPair(s)];
+		for (int y = 2; y < BOARD_HEIGHT - 2; y++) result += tables.middle[y][RowTables::Row(s, y)];
+		return result;
+	}
+}
@@ -0,0 +1,75 @@
+#include "GameClock.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include "Timing.h"
+
+using namespace std;
+
+#define TENTHS_BELOW 10.0
+
+GameClock::GameClock(double base, double increment) : base(base), increment(increment) {
+	Reset();
+}
+
+void GameClock::Reset() {
+	for (double& r : remaining) r = base;
+	running = PLAYER_NONE;
+	started = 0;
+}
+
+void GameClock::Start(Player p) {
+	Stop();
+	running = p;
+	started = Timing::Now();
+}
+
+void GameClock::Stop() {
+	if (running == PLAYER_NONE) return;
+	double& r = remaining[running];
+	r -= Timing::Now() - started;
+	if (r > 0) {
+		r += increment;
+	} else {
+		r = 0;
+	}
+	running = PLAYER_NONE;
+}
+
+Player GameClock::Running() const {
+	return running;
+}
+
+double GameClock::Remaining(Player p) const {
+	double r = remaining[p];
+	if (p == running) r -= Timing::Now() - started;
+	return r > 0 ? r : 0;
+}
+
+double GameClock::Increment() const {
+	return increment;
+}
+
+Player GameClock::Flagged() const {
+	if (Remaining(PLAYER_WHITE) <= 0) return PLAYER_WHITE;
+	if (Remaining(PLAYER_BLACK) <= 0) return PLAYER_BLACK;
+	return PLAYER_NONE;
+}
+
+double GameClock::UntilDisplayChange(Player p) const {
+	double r = Remaining(p);
+	double unit = r >= TENTHS_BELOW ? 1.0 : 0.1;
+	return r - floor(r / unit) * unit;
+}
+
+string GameClock::Format(double seconds) {
+	char buf[16];
+	if (seconds >= TENTHS_BELOW) {
+		int s = (int)seconds;
+		snprintf(buf, sizeof(buf), "%d:%02d", s / 60, s % 60);
+	} else {
+		snprintf(buf, sizeof(buf), "%.1f", floor(seconds * 10) / 10);
+	}
+	return buf;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+
+#include "GameStates.h"
+
+// Chess-style clocks: each player starts with the base time and gains the
+// increment after every move they complete in time
+class GameClock {
+public:
+	GameClock(double base, double increment);
+	// Refills both clocks and stops them
+	void Reset();
+	// Runs p's clock; any other running clock is stopped first
+	void Start(Player p);
+	// Stops the running clock, adding the increment unless its time ran out
+	void Stop();
+	Player Running() const;
+	double Remaining(Player p) const;
+	double Increment() const;
+	// The player whose time has run out, or PLAYER_NONE
+	Player Flagged() const;
+	// Seconds until Format(Remaining(p)) next changes
+	double UntilDisplayChange(Player p) const;
+	// m:ss, or seconds with tenths below ten seconds
+	static std::string Format(double seconds);
+private:
+	double base;
+	double increment;
+	double remaining[3];
+	Player running;
+	double started;
+};
@@ -0,0 +1,295 @@
+// fopen is fine here; the secure variants are not portable
+#define _CRT_SECURE_NO_WARNINGS
+#include "GameRecord.h"
+
+#include <cstring>
+
+using namespace std;
+
+#ifdef _MSC_VER
+#define fseek64 _fseeki64
+#else
+#define fseek64 fseeko
+#endif
+
+static const char fileMagic[8] = { 'S', 'W', 'A', 'P', 'G', 'A', 'M', 'E' };
+
+RecordError::RecordError(const string& msg) : runtime_error(msg) { }
+
+void GameRecord::Clear() {
+	start = 0;
+	firstPlayer = PLAYER_WHITE;
+	winner = PLAYER_NONE;
+	whiteIsAI = false;
+	blackIsAI = false;
+	onTime = false;
+	moves.clear();
+}
+
+Player GameRecord::ToMove(size_t move) const {
+	return (move & 1) ? OtherPlayer(firstPlayer) : firstPlayer;
+}
+
+uint8_t EncodeMove(int swapPos, bool vertical) {
+	return (uint8_t)(swapPos | (vertical ? 0x40 : 0));
+}
+
+bool DecodeMove(uint8_t move, int& swapPos, bool& vertical) {
+	if (move & 0x80) return false;
+	swapPos = move & 0x3F;
+	vertical = !!(move & 0x40);
+	if (swapPos >= BOARD_CELLS) return false;
+	if (vertical) return swapPos / BOARD_WIDTH < BOARD_HEIGHT - 1;
+	return swapPos % BOARD_WIDTH < BOARD_WIDTH - 1;
+}
+
+bool ReplayGame(const GameRecord& rec, vector<GameState>& positions, unordered_set<GameState>& seen) {
+	positions.clear();
+	seen.clear();
+	if (rec.start >> BOARD_CELLS) return false;
+	GameState s = rec.start;
+	seen.insert(s);
+	for (uint8_t m : rec.moves) {
+		int swapPos;
+		bool vertical;
+		if (GetWinner(s) != PLAYER_NONE) return false;
+		if (!DecodeMove(m, swapPos, vertical)) return false;
+		positions.push_back(s);
+		s = PerformSwap(s, swapPos, vertical);
+		if (!seen.insert(s).second) return false;
+	}
+	positions.push_back(s);
+	if (rec.onTime) return GetWinner(s) == PLAYER_NONE && rec.winner != PLAYER_NONE;
+	return GetWinner(s) == rec.winner;
+}
+
+static inline void PutU32(uint8_t* p, uint32_t v) {
+	for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline void PutU64(uint8_t* p, uint64_t v) {
+	for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline uint32_t GetU32(const uint8_t* p) {
+	uint32_t v = 0;
+	for (int i = 0; i < 4; i++) v |= (uint32_t)p[i] << (8 * i);
+	return v;
+}
+
+static inline uint64_t GetU64(const uint8_t* p) {
+	uint64_t v = 0;
+	for (int i = 0; i < 8; i++) v |= (uint64_t)p[i] << (8 * i);
+	return v;
+}
+
+static void MakeFileHeader(uint8_t* h) {
+	memcpy(h, fileMagic, 8);
+	PutU32(h + 8, RECORD_VERSION);
+	h[12] = BOARD_WIDTH;
+	h[13] = BOARD_HEIGHT;
+	h[14] = 0;
+	h[15] = 0;
+}
+
+static void CheckFileHeader(const uint8_t* h, const string& path) {
+	uint8_t expected[RECORD_FILE_HEADER_SIZE];
+	MakeFileHeader(expected);
+	if (memcmp(h, expected, 8) != 0) throw RecordError(path + " is not a game record file");
+	if (GetU32(h + 8) != RECORD_VERSION) throw RecordError(path + " has an unsupported record version");
+	if (memcmp(h + 12, expected + 12, 4) != 0) throw RecordError(path + " was recorded on a different board size");
+}
+
+GameRecordWriter::GameRecordWriter(const string& path) {
+	uint8_t header[RECORD_FILE_HEADER_SIZE];
+	bool existing = false;
+	file = fopen(path.c_str(), "rb");
+	if (file) {
+		size_t got = fread(header, 1, RECORD_FILE_HEADER_SIZE, file);
+		fclose(file);
+		if (got == RECORD_FILE_HEADER_SIZE) {
+			CheckFileHeader(header, path);
+			existing = true;
+		} else if (got != 0) {
+			throw RecordError(path + " is truncated");
+		}
+	}
+	file = fopen(path.c_str(), existing ? "ab" : "wb");
+	if (!file) throw RecordError("Cannot open " + path + " for writing");
+	buffer.reserve(RECORD_BUFFER_SIZE);
+	if (!existing) {
+		MakeFileHeader(header);
+		Put(header, RECORD_FILE_HEADER_SIZE);
+	}
+}
+
+GameRecordWriter::~GameRecordWriter() {
+	try {
+		Flush();
+	} catch (RecordError&) {
+	}
+	fclose(file);
+}
+
+void GameRecordWriter::Put(const void* data, size_t size) {
+	if (buffer.size() + size > RECORD_BUFFER_SIZE) Flush();
+	if (size > RECORD_BUFFER_SIZE) {
+		if (fwrite(data, 1, size, file) != size) throw RecordError("Failed writing game record");
+		return;
+	}
+	const uint8_t* bytes = (const uint8_t*)data;
+	buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+void GameRecordWriter::Write(const GameRecord& rec) {
+	if (rec.moves.size() > RECORD_MAX_MOVES) throw RecordError("Game is too long to record");
+	uint8_t header[RECORD_GAME_HEADER_SIZE];
+	header[0] = RECORD_SYNC;
+	header[1] = (uint8_t)(rec.firstPlayer |
+		(rec.whiteIsAI ? RECORD_FLAG_WHITE_AI : 0) |
+		(rec.blackIsAI ? RECORD_FLAG_BLACK_AI : 0) |
+		(rec.onTime ? RECORD_FLAG_ON_TIME : 0));
+	header[2] = (uint8_t)rec.winner;
+	header[3] = 0;
+	PutU32(header + 4, (uint32_t)rec.moves.size());
+	PutU64(header + 8, (uint64_t)rec.start);
+	Put(header, RECORD_GAME_HEADER_SIZE);
+	if (!rec.moves.empty()) Put(rec.moves.data(), rec.moves.size());
+	games++;
+}
+
+void GameRecordWriter::Flush() {
+	if (!buffer.empty()) {
+		size_t written = fwrite(buffer.data(), 1, buffer.size(), file);
+		bool ok = written == buffer.size();
+		buffer.clear();
+		if (!ok) throw RecordError("Failed writing game record");
+	}
+	fflush(file);
+}
+
+uint64_t GameRecordWriter::GamesWritten() const {
+	return games;
+}
+
+GameRecordReader::GameRecordReader(const string& path) : buffer(RECORD_BUFFER_SIZE) {
+	file = fopen(path.c_str(), "rb");
+	if (!file) throw RecordError("Cannot open " + path);
+	if (!Fill(RECORD_FILE_HEADER_SIZE)) {
+		fclose(file);
+		throw RecordError(path + " is not a game record file");
+	}
+	try {
+		CheckFileHeader(buffer.data(), path);
+	} catch (RecordError&) {
+		fclose(file);
+		throw;
+	}
+	bufPos = RECORD_FILE_HEADER_SIZE;
+	offsets.push_back(RECORD_FILE_HEADER_SIZE);
+}
+
+GameRecordReader::~GameRecordReader() {
+	fclose(file);
+}
+
+uint64_t GameRecordReader::Tell() const {
+	return bufOffset + bufPos;
+}
+
+void GameRecordReader::Seek(uint64_t offset) {
+	if (offset >= bufOffset && offset <= bufOffset + bufLen) {
+		bufPos = (size_t)(offset - bufOffset);
+		return;
+	}
+	if (fseek64(file, offset, SEEK_SET) != 0) throw RecordError("Seek failed in game record file");
+	bufOffset = offset;
+	bufPos = 0;
+	bufLen = 0;
+}
+
+bool GameRecordReader::Fill(size_t needed) {
+	if (bufLen - bufPos >= needed) return true;
+	if (needed > buffer.size()) buffer.resize(needed);
+	// Keep the unread tail and top the buffer up behind it
+	size_t remaining = bufLen - bufPos;
+	memmove(buffer.data(), buffer.data() + bufPos, remaining);
+	bufOffset += bufPos;
+	bufPos = 0;
+	bufLen = remaining;
+	bufLen += fread(buffer.data() + bufLen, 1, buffer.size() - bufLen, file);
+	return bufLen >= needed;
+}
+
+bool GameRecordReader::ReadHeader(GameRecord& rec, uint32_t& moveCount) {
+	if (!Fill(RECORD_GAME_HEADER_SIZE)) {
+		if (bufLen != bufPos) throw RecordError("Game record file is truncated");
+		return false;
+	}
+	const uint8_t* h = buffer.data() + bufPos;
+	if (h[0] != RECORD_SYNC) throw RecordError("Game record file is corrupt");
+	rec.firstPlayer = (Player)(h[1] & 3);
+	rec.whiteIsAI = !!(h[1] & RECORD_FLAG_WHITE_AI);
+	rec.blackIsAI = !!(h[1] & RECORD_FLAG_BLACK_AI);
+	rec.onTime = !!(h[1] & RECORD_FLAG_ON_TIME);
+	rec.winner = (Player)h[2];
+	if (rec.firstPlayer == PLAYER_NONE || rec.firstPlayer > PLAYER_WHITE || rec.winner > PLAYER_WHITE) {
+		throw RecordError("Game record file is corrupt");
+	}
+	moveCount = GetU32(h + 4);
+	if (moveCount > RECORD_MAX_MOVES) throw RecordError("Game record file is corrupt");
+	rec.start = (GameState)GetU64(h + 8);
+	bufPos += RECORD_GAME_HEADER_SIZE;
+	return true;
+}
+
+bool GameRecordReader::Next(GameRecord& rec) {
+	bool newOffset = gameIndex == offsets.size();
+	if (newOffset) offsets.push_back(Tell());
+	uint32_t moveCount;
+	if (!ReadHeader(rec, moveCount)) {
+		if (newOffset) offsets.pop_back();
+		return false;
+	}
+	if (!Fill(moveCount)) throw RecordError("Game record file is truncated");
+	rec.moves.assign(buffer.data() + bufPos, buffer.data() + bufPos + moveCount);
+	bufPos += moveCount;
+	if (validate && !ReplayGame(rec, positions, seen)) {
+		throw RecordError("Game " + to_string(gameIndex) + " contains an illegal move");
+	}
+	gameIndex++;
+	return true;
+}
+
+bool GameRecordReader::SeekGame(uint64_t index) {
+	if (index < offsets.size()) {
+		Seek(offsets[(size_t)index]);
+		gameIndex = index;
+		return true;
+	}
+	// Hop from header to header past the last known game, remembering each offset
+	Seek(offsets.back());
+	gameIndex = offsets.size() - 1;
+	GameRecord rec;
+	while (gameIndex < index) {
+		uint32_t moveCount;
+		if (!ReadHeader(rec, moveCount)) return false;
+		Seek(Tell() + moveCount);
+		gameIndex++;
+		if (!Fill(RECORD_GAME_HEADER_SIZE)) return false;
+		offsets.push_back(Tell());
+	}
+	return true;
+}
+
+uint64_t GameRecordReader::GameIndex() const {
+	return gameIndex;
+}
+
+void GameRecordReader::SetValidate(bool v) {
+	validate = v;
+}
+
+const vector<GameState>& GameRecordReader::Positions() const {
+	return positions;
+}
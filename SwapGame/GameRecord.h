@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "GameStates.h"
+
+// File layout (all integers little-endian):
+//   File header, 16 bytes: "SWAPGAME", u32 version, u8 width, u8 height, u16 zero
+//   Each game, 16 bytes + one per move:
+//     u8 sync (RECORD_SYNC), u8 flags, u8 winner, u8 zero, u32 move count,
+//     u64 start state, then the moves
+// Flags: bits 0-1 hold the player who moves first. Bit 2 is set when white
+// was a CPU, bit 3 when black was, and bit 4 when the loser ran out of time.
+// A move byte holds swapPos in bits 0-5 and vertical in bit 6.
+#define RECORD_VERSION 1
+#define RECORD_FILE_HEADER_SIZE 16
+#define RECORD_GAME_HEADER_SIZE 16
+#define RECORD_SYNC 0xA5
+#define RECORD_BUFFER_SIZE (64 * 1024)
+// Most moves a game may hold. Games never repeat a position, but that bound
+// is in the billions; this one only stops a corrupt header from making the
+// reader allocate gigabytes.
+#define RECORD_MAX_MOVES (1 << 20)
+
+#define RECORD_FLAG_WHITE_AI 4
+#define RECORD_FLAG_BLACK_AI 8
+#define RECORD_FLAG_ON_TIME 16
+
+class RecordError : public std::runtime_error {
+public:
+	RecordError(const std::string& msg);
+};
+
+struct GameRecord {
+	GameState start = 0;
+	Player firstPlayer = PLAYER_WHITE;
+	Player winner = PLAYER_NONE;
+	bool whiteIsAI = false;
+	bool blackIsAI = false;
+	// The winner won on time, so the final position is not itself won
+	bool onTime = false;
+	std::vector<uint8_t> moves;
+	void Clear();
+	// Player to move before the given move
+	Player ToMove(size_t move) const;
+};
+
+uint8_t EncodeMove(int swapPos, bool vertical);
+// Returns false if the byte is not a swap that fits on the board
+bool DecodeMove(uint8_t move, int& swapPos, bool& vertical);
+
+// Replays a game, checking each move is on the board, reaches a position not
+// seen before and is not made after the game was won. The recorded winner
+// must match the final position, unless the game was won on time from an
+// undecided one. Fills positions with the state before each move followed
+// by the final state. Returns false if the game is invalid.
+bool ReplayGame(const GameRecord& rec, std::vector<GameState>& positions, std::unordered_set<GameState>& seen);
+
+class GameRecordWriter {
+public:
+	// Appends to an existing record file, or starts a new one
+	GameRecordWriter(const std::string& path);
+	~GameRecordWriter();
+	void Write(const GameRecord& rec);
+	void Flush();
+	uint64_t GamesWritten() const;
+private:
+	FILE* file;
+	std::vector<uint8_t> buffer;
+	uint64_t games = 0;
+	void Put(const void* data, size_t size);
+};
+
+class GameRecordReader {
+public:
+	GameRecordReader(const std::string& path);
+	~GameRecordReader();
+	// Reads the next game, returning false at the end of the file. Malformed
+	// data throws RecordError; so do illegal games when validating.
+	bool Next(GameRecord& rec);
+	// Moves to the start of the given game, returning false if there are fewer games
+	bool SeekGame(uint64_t index);
+	// Index of the game the next call to Next will return
+	uint64_t GameIndex() const;
+	void SetValidate(bool v);
+	// Positions of the last game read, filled in while validating
+	const std::vector<GameState>& Positions() const;
+private:
+	FILE* file;
+	std::vector<uint8_t> buffer;
+	size_t bufPos = 0, bufLen = 0;
+	uint64_t bufOffset = 0;
+	uint64_t gameIndex = 0;
+	bool validate = true;
+	// File offsets of every game start seen so far; offsets[i] is game i
+	std::vector<uint64_t> offsets;
+	std::vector<GameState> positions;
+	std::unordered_set<GameState> seen;
+
+	uint64_t Tell() const;
+	void Seek(uint64_t offset);
+	bool Fill(size_t needed);
+	bool ReadHeader(GameRecord& rec, uint32_t& moveCount);
+};
@@ -0,0 +1,426 @@
+// fopen is fine here; the secure variants are not portable
+#define _CRT_SECURE_NO_WARNINGS
+#include "IndexBuilder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <queue>
+#include <thread>
+
+#include "GameRecord.h"
+#include "PositionDB.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <climits>
+#endif
+
+using namespace std;
+
+#ifdef _MSC_VER
+#define fseek64 _fseeki64
+#else
+#define fseek64 fseeko
+#endif
+
+#define IO_BUFFER_BYTES (256 * 1024)
+
+enum Outcome { OUTCOME_WIN, OUTCOME_LOSS, OUTCOME_DRAW };
+
+// One position reached in one game, with the move played from it and how
+// the game ended for the side to move
+struct Occurrence {
+	uint64_t key;
+	uint8_t move;
+	uint8_t outcome;
+};
+
+static bool operator<(const Occurrence& a, const Occurrence& b) {
+	return a.key < b.key || (a.key == b.key && a.move < b.move);
+}
+
+// Ordering and combining of table entries for the merge
+static bool Before(const PositionEntry& a, const PositionEntry& b) {
+	return a.key < b.key;
+}
+static bool Before(const MoveEntry& a, const MoveEntry& b) {
+	return a.key < b.key || (a.key == b.key && a.move < b.move);
+}
+static bool SameSlot(const PositionEntry& a, const PositionEntry& b) {
+	return a.key == b.key;
+}
+static bool SameSlot(const MoveEntry& a, const MoveEntry& b) {
+	return a.key == b.key && a.move == b.move;
+}
+static void Combine(PositionEntry& into, const PositionEntry& e) {
+	into.wins += e.wins;
+	into.losses += e.losses;
+	into.draws += e.draws;
+}
+static void Combine(MoveEntry& into, const MoveEntry& e) {
+	into.count += e.count;
+}
+
+// Absolute form of a path, so the same record file reached two ways is
+// recognised as one source; empty if the file cannot be resolved
+static string CanonicalPath(const string& path) {
+#ifdef _WIN32
+	char full[MAX_PATH];
+	if (!_fullpath(full, path.c_str(), MAX_PATH)) return string();
+	return full;
+#else
+	char full[PATH_MAX];
+	if (!realpath(path.c_str(), full)) return string();
+	return full;
+#endif
+}
+
+// Moves a finished file over another in one step, so the target is never
+// missing if the move fails
+static bool MoveOver(const string& from, const string& to) {
+#ifdef _WIN32
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+static FILE* OpenFile(const string& path, const char* mode) {
+	FILE* file = fopen(path.c_str(), mode);
+	if (!file) throw RecordError("Cannot open " + path);
+	return file;
+}
+
+// Streams a sorted table from part of a file
+template <typename Entry>
+class EntryReader {
+public:
+	EntryReader(const string& path, uint64_t offset, uint64_t count) :
+		file(OpenFile(path, "rb")), buffer(IO_BUFFER_BYTES / sizeof(Entry)), remaining(count) {
+		if (fseek64(file, offset, SEEK_SET) != 0) {
+			fclose(file);
+			throw RecordError("Cannot read " + path);
+		}
+		Advance();
+	}
+	~EntryReader() {
+		fclose(file);
+	}
+	bool Done() const {
+		return done;
+	}
+	const Entry& Current() const {
+		return buffer[pos];
+	}
+	void Advance() {
+		if (++pos < len) return;
+		size_t n = (size_t)min<uint64_t>(remaining, buffer.size());
+		if (n == 0 || fread(buffer.data(), sizeof(Entry), n, file) != n) {
+			// A short read means the table is truncated; stopping early would lose counts
+			if (n != 0) throw RecordError("Index data is truncated");
+			done = true;
+			return;
+		}
+		remaining -= n;
+		len = n;
+		pos = 0;
+	}
+private:
+	FILE* file;
+	vector<Entry> buffer;
+	uint64_t remaining;
+	size_t pos = 0, len = 0;
+	bool done = false;
+};
+
+template <typename Entry>
+class EntryWriter {
+public:
+	EntryWriter(const string& path) : path(path), file(OpenFile(path, "wb")) {
+		buffer.reserve(IO_BUFFER_BYTES / sizeof(Entry));
+	}
+	~EntryWriter() {
+		if (file) fclose(file);
+	}
+	void Put(const Entry& e) {
+		buffer.push_back(e);
+		if (buffer.size() == buffer.capacity()) Flush();
+	}
+	void Close() {
+		Flush();
+		int result = fclose(file);
+		file = nullptr;
+		if (result != 0) throw RecordError("Failed writing " + path);
+	}
+	uint64_t Written() const {
+		return written;
+	}
+private:
+	string path;
+	FILE* file;
+	vector<Entry> buffer;
+	uint64_t written = 0;
+	void Flush() {
+		if (fwrite(buffer.data(), sizeof(Entry), buffer.size(), file) != buffer.size()) {
+			throw RecordError("Failed writing " + path);
+		}
+		written += buffer.size();
+		buffer.clear();
+	}
+};
+
+// A sorted run: a position table and a move table, each in its own file so
+// the two merges can stream them independently
+struct Run {
+	string path;
+	uint64_t positions = 0;
+	uint64_t moves = 0;
+};
+
+static void WriteRun(Occurrence* begin, Occurrence* end, Run& run) {
+	sort(begin, end);
+	EntryWriter<PositionEntry> positions(run.path + ".pos");
+	EntryWriter<MoveEntry> moves(run.path + ".mov");
+	for (Occurrence* o = begin; o != end;) {
+		PositionEntry pe = {};
+		pe.key = o->key;
+		while (o != end && o->key == pe.key) {
+			MoveEntry me = {};
+			me.key = pe.key;
+			me.move = o->move;
+			for (; o != end && o->key == pe.key && o->move == me.move; o++) {
+				me.count++;
+				if (o->outcome == OUTCOME_WIN) pe.wins++;
+				else if (o->outcome == OUTCOME_LOSS) pe.losses++;
+				else pe.draws++;
+			}
+			if (me.move != INDEX_NO_MOVE) moves.Put(me);
+		}
+		positions.Put(pe);
+	}
+	positions.Close();
+	moves.Close();
+	run.positions = positions.Written();
+	run.moves = moves.Written();
+}
+
+template <typename Entry>
+static uint64_t MergeTables(vector<unique_ptr<EntryReader<Entry>>>& inputs, const string& outPath) {
+	auto later = [&](size_t a, size_t b) { return Before(inputs[b]->Current(), inputs[a]->Current()); };
+	priority_queue<size_t, vector<size_t>, decltype(later)> heap(later);
+	for (size_t i = 0; i < inputs.size(); i++) {
+		if (!inputs[i]->Done()) heap.push(i);
+	}
+	EntryWriter<Entry> out(outPath);
+	Entry pending;
+	bool havePending = false;
+	while (!heap.empty()) {
+		size_t i = heap.top();
+		heap.pop();
+		const Entry& e = inputs[i]->Current();
+		if (havePending && SameSlot(pending, e)) {
+			Combine(pending, e);
+		} else {
+			if (havePending) out.Put(pending);
+			pending = e;
+			havePending = true;
+		}
+		inputs[i]->Advance();
+		if (!inputs[i]->Done()) heap.push(i);
+	}
+	if (havePending) out.Put(pending);
+	out.Close();
+	return out.Written();
+}
+
+static void AppendFile(FILE* out, const string& path) {
+	FILE* in = OpenFile(path, "rb");
+	vector<char> buffer(IO_BUFFER_BYTES);
+	size_t n;
+	while ((n = fread(buffer.data(), 1, buffer.size(), in)) > 0) {
+		if (fwrite(buffer.data(), 1, n, out) != n) {
+			fclose(in);
+			throw RecordError("Failed writing index");
+		}
+	}
+	fclose(in);
+}
+
+static void Put(FILE* out, const void* data, size_t size) {
+	if (fwrite(data, 1, size, out) != size) throw RecordError("Failed writing index");
+}
+
+uint64_t BuildIndex(const string& indexPath, const vector<string>& records, const IndexBuildOptions& options) {
+	int threads = options.threads > 0 ? options.threads : (int)thread::hardware_concurrency();
+	if (threads < 1) threads = 1;
+
+	IndexHeader old = {};
+	vector<IndexSource> sources;
+	bool haveOld = false;
+	if (FILE* f = fopen(indexPath.c_str(), "rb")) {
+		try {
+			ReadIndexInfo(f, old, sources);
+		} catch (RecordError&) {
+			fclose(f);
+			throw;
+		}
+		fclose(f);
+		haveOld = true;
+		// Indexes built before paths were stored absolute name files relative
+		// to where they were built; resolve those that still exist from here
+		for (IndexSource& s : sources) {
+			string canonical = CanonicalPath(s.path);
+			if (!canonical.empty()) s.path = canonical;
+		}
+	}
+
+	// Read the new games, sorting full buffers into runs on all threads
+	vector<Run> runs;
+	vector<Occurrence> pending;
+	pending.reserve(options.bufferEntries);
+	auto writeRuns = [&]() {
+		if (pending.empty()) return;
+		size_t slice = (pending.size() + threads - 1) / threads;
+		size_t first = runs.size();
+		for (size_t start = 0; start < pending.size(); start += slice) {
+			Run run;
+			run.path = indexPath + ".run" + to_string(runs.size());
+			runs.push_back(run);
+		}
+		vector<thread> pool;
+		vector<exception_ptr> errors(runs.size() - first);
+		for (size_t r = first; r < runs.size(); r++) {
+			size_t start = (r - first) * slice;
+			size_t end = min(start + slice, pending.size());
+			pool.emplace_back([&, r, start, end]() {
+				try {
+					WriteRun(pending.data() + start, pending.data() + end, runs[r]);
+				} catch (...) {
+					errors[r - first] = current_exception();
+				}
+			});
+		}
+		for (thread& t : pool) t.join();
+		for (exception_ptr& e : errors) {
+			if (e) rethrow_exception(e);
+		}
+		pending.clear();
+	};
+	uint64_t added = 0;
+	GameRecord rec;
+	for (const string& record : records) {
+		string path = CanonicalPath(record);
+		if (path.empty()) throw RecordError("Cannot open " + record);
+		auto source = find_if(sources.begin(), sources.end(),
+			[&](const IndexSource& s) { return s.path == path; });
+		if (source == sources.end()) {
+			IndexSource s;
+			s.path = path;
+			s.games = 0;
+			source = sources.insert(sources.end(), s);
+		}
+		GameRecordReader reader(path);
+		// Skip to just past the last game already indexed
+		if (source->games > 0 && (!reader.SeekGame(source->games - 1) || !reader.Next(rec))) {
+			throw RecordError(path + " has fewer games than the index already holds");
+		}
+		while (reader.Next(rec)) {
+			const vector<GameState>& positions = reader.Positions();
+			for (size_t i = 0; i < positions.size(); i++) {
+				Player toMove = rec.ToMove(i);
+				Occurrence o;
+				o.key = IndexKey(positions[i], toMove);
+				o.move = i < rec.moves.size() ? rec.moves[i] : INDEX_NO_MOVE;
+				// Undecided games count as draws, as in the tuner
+				o.outcome = rec.winner == PLAYER_NONE ? OUTCOME_DRAW :
+					rec.winner == toMove ? OUTCOME_WIN : OUTCOME_LOSS;
+				pending.push_back(o);
+			}
+			source->games++;
+			added++;
+			if (pending.size() >= options.bufferEntries) writeRuns();
+		}
+	}
+	writeRuns();
+	if (added == 0 && haveOld) return 0;
+
+	// Merge the runs with the existing index; the two tables are independent,
+	// so they are merged at the same time
+	string positionsPath = indexPath + ".pos.tmp";
+	string movesPath = indexPath + ".mov.tmp";
+	uint64_t positionCount = 0, moveCount = 0;
+	{
+		vector<unique_ptr<EntryReader<PositionEntry>>> positionInputs;
+		vector<unique_ptr<EntryReader<MoveEntry>>> moveInputs;
+		if (haveOld) {
+			positionInputs.emplace_back(new EntryReader<PositionEntry>(indexPath, old.positionsOffset, old.positionCount));
+			moveInputs.emplace_back(new EntryReader<MoveEntry>(indexPath, old.movesOffset, old.moveCount));
+		}
+		for (const Run& run : runs) {
+			positionInputs.emplace_back(new EntryReader<PositionEntry>(run.path + ".pos", 0, run.positions));
+			moveInputs.emplace_back(new EntryReader<MoveEntry>(run.path + ".mov", 0, run.moves));
+		}
+		exception_ptr moveError;
+		thread moveMerge([&]() {
+			try {
+				moveCount = MergeTables(moveInputs, movesPath);
+			} catch (...) {
+				moveError = current_exception();
+			}
+		});
+		try {
+			positionCount = MergeTables(positionInputs, positionsPath);
+		} catch (...) {
+			moveMerge.join();
+			throw;
+		}
+		moveMerge.join();
+		if (moveError) rethrow_exception(moveError);
+	}
+	for (const Run& run : runs) {
+		remove((run.path + ".pos").c_str());
+		remove((run.path + ".mov").c_str());
+	}
+
+	// Assemble the new index next to the old one, then replace it
+	IndexHeader header = {};
+	memcpy(header.magic, "SWAPIDX", 8);
+	header.version = INDEX_VERSION;
+	header.byteOrder = INDEX_BYTE_ORDER;
+	header.width = BOARD_WIDTH;
+	header.height = BOARD_HEIGHT;
+	header.positionCount = positionCount;
+	header.moveCount = moveCount;
+	header.positionsOffset = sizeof(IndexHeader);
+	header.movesOffset = header.positionsOffset + positionCount * sizeof(PositionEntry);
+	header.sourcesOffset = header.movesOffset + moveCount * sizeof(MoveEntry);
+	string newPath = indexPath + ".new";
+	FILE* out = OpenFile(newPath, "wb");
+	try {
+		Put(out, &header, sizeof(header));
+		AppendFile(out, positionsPath);
+		AppendFile(out, movesPath);
+		uint32_t count = (uint32_t)sources.size();
+		Put(out, &count, sizeof(count));
+		for (const IndexSource& s : sources) {
+			uint32_t length = (uint32_t)s.path.size();
+			Put(out, &s.games, sizeof(s.games));
+			Put(out, &length, sizeof(length));
+			Put(out, s.path.data(), length);
+		}
+	} catch (RecordError&) {
+		fclose(out);
+		throw;
+	}
+	if (fclose(out) != 0) throw RecordError("Failed writing " + newPath);
+	if (!MoveOver(newPath, indexPath)) throw RecordError("Cannot replace " + indexPath);
+	remove(positionsPath.c_str());
+	remove(movesPath.c_str());
+	return added;
+}
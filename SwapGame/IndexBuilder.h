@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct IndexBuildOptions {
+	// Positions held in memory before they are sorted, split between the
+	// threads, and written out as runs; 16 bytes each
+	size_t bufferEntries = 1 << 23;
+	int threads = 0;
+};
+
+// Adds the games of the record files to the index at indexPath, creating it
+// if needed. Each thread sorts its share of the positions into a run file;
+// the runs and any existing index are then merged into the new index. The
+// index remembers how many games of each record file it holds, so after
+// games are appended to a file only the new ones are read. Returns the
+// number of games added.
+uint64_t BuildIndex(const std::string& indexPath, const std::vector<std::string>& records,
+	const IndexBuildOptions& options);
@@ -0,0 +1,205 @@
+#include "LeafEval.h"
+
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define LEAF_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#define TARGET_AVX512
+#else
+#include <cpuid.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx2,avx512f")))
+#endif
+// AVX-512 intrinsics arrived in Visual Studio 2017 15.3
+#if !defined(_MSC_VER) || _MSC_VER >= 1911
+#define LEAF_AVX512
+#endif
+#endif
+
+namespace LeafEval {
+	typedef void (*EvalFunction)(const EvalTables&, Player, const GameState*, int, int*);
+
+	static void EvaluateScalar(const EvalTables& t, Player p, const GameState* states, int count, int* scores) {
+		for (int i = 0; i < count; i++) {
+			GameState s = states[i];
+			Player winner = GetWinner(s);
+			int score;
+			if (winner != PLAYER_NONE) {
+				score = winner == PLAYER_BLACK ? EVAL_WIN : -EVAL_WIN;
+			} else {
+				score = Eval::Evaluate(t, s);
+			}
+			scores[i] = p == PLAYER_WHITE ? -score : score;
+		}
+	}
+
+#ifdef LEAF_X86
+	// Each lane gathers its row scores straight from the tables; the win test
+	// is done on the whole states and blended over the result
+	TARGET_AVX2 static void EvaluateAVX2(const EvalTables& t, Player p, const GameState* states, int count, int* scores) {
+		const __m256i rowMask = _mm256_set1_epi64x(ROW_BITS);
+		const __m256i bottomMask = _mm256_set1_epi64x(BottomRowMask);
+		const __m256i zero = _mm256_setzero_si256();
+		// Picks the low half of each 64-bit mask
+		const __m256i narrow = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+		const __m128i win = _mm_set1_epi32(EVAL_WIN);
+		const __m128i loss = _mm_set1_epi32(-EVAL_WIN);
+
+		int i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m256i s = _mm256_loadu_si256((const __m256i*)(states + i));
+			__m256i top = _mm256_or_si256(_mm256_and_si256(s, rowMask),
+				_mm256_slli_epi64(_mm256_and_si256(_mm256_srli_epi64(s, BOARD_WIDTH), rowMask), BOARD_WIDTH));
+			__m256i bottom = _mm256_or_si256(
+				_mm256_and_si256(_mm256_srli_epi64(s, (BOARD_HEIGHT - 1) * BOARD_WIDTH), rowMask),
+				_mm256_slli_epi64(_mm256_and_si256(_mm256_srli_epi64(s, (BOARD_HEIGHT - 2) * BOARD_WIDTH), rowMask), BOARD_WIDTH));
+			__m128i score = _mm_add_epi32(_mm256_i64gather_epi32(t.top, top, 4), _mm256_i64gather_epi32(t.bottom, bottom, 4));
+			for (int y = 2; y < BOARD_HEIGHT - 2; y++) {
+				__m256i row = _mm256_and_si256(_mm256_srl_epi64(s, _mm_cvtsi32_si128(y * BOARD_WIDTH)), rowMask);
+				score = _mm_add_epi32(score, _mm256_i64gather_epi32(t.middle[y], row, 4));
+			}
+			// Win test, black first as in GetWinner
+			__m256i whiteWins = _mm256_cmpeq_epi64(_mm256_and_si256(s, bottomMask), bottomMask);
+			__m256i blackWins = _mm256_cmpeq_epi64(_mm256_and_si256(s, rowMask), zero);
+			score = _mm_blendv_epi8(score, loss, _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(whiteWins, narrow)));
+			score = _mm_blendv_epi8(score, win, _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(blackWins, narrow)));
+			if (p == PLAYER_WHITE) score = _mm_sub_epi32(_mm_setzero_si128(), score);
+			_mm_storeu_si128((__m128i*)(scores + i), score);
+		}
+		EvaluateScalar(t, p, states + i, count - i, scores + i);
+	}
+
+#ifdef LEAF_AVX512
+	TARGET_AVX512 static void EvaluateAVX512(const EvalTables& t, Player p, const GameState* states, int count, int* scores) {
+		const __m512i rowMask = _mm512_set1_epi64(ROW_BITS);
+		const __m512i bottomMask = _mm512_set1_epi64(BottomRowMask);
+		const __m512i zero = _mm512_setzero_si512();
+		const __m512i win = _mm512_set1_epi64(EVAL_WIN);
+		const __m512i loss = _mm512_set1_epi64(-EVAL_WIN);
+
+		int i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m512i s = _mm512_loadu_si512((const void*)(states + i));
+			__m512i top = _mm512_or_si512(_mm512_and_si512(s, rowMask),
+				_mm512_slli_epi64(_mm512_and_si512(_mm512_srli_epi64(s, BOARD_WIDTH), rowMask), BOARD_WIDTH));
+			__m512i bottom = _mm512_or_si512(
+				_mm512_and_si512(_mm512_srli_epi64(s, (BOARD_HEIGHT - 1) * BOARD_WIDTH), rowMask),
+				_mm512_slli_epi64(_mm512_and_si512(_mm512_srli_epi64(s, (BOARD_HEIGHT - 2) * BOARD_WIDTH), rowMask), BOARD_WIDTH));
+			__m256i sum = _mm256_add_epi32(_mm512_i64gather_epi32(top, t.top, 4), _mm512_i64gather_epi32(bottom, t.bottom, 4));
+			for (int y = 2; y < BOARD_HEIGHT - 2; y++) {
+				__m512i row = _mm512_and_si512(_mm512_srl_epi64(s, _mm_cvtsi32_si128(y * BOARD_WIDTH)), rowMask);
+				sum = _mm256_add_epi32(sum, _mm512_i64gather_epi32(row, t.middle[y], 4));
+			}
+			// Blend in 64-bit lanes, where the masks apply without AVX-512VL
+			__m512i score = _mm512_cvtepi32_epi64(sum);
+			__mmask8 whiteWins = _mm512_cmpeq_epi64_mask(_mm512_and_si512(s, bottomMask), bottomMask);
+			__mmask8 blackWins = _mm512_cmpeq_epi64_mask(_mm512_and_si512(s, rowMask), zero);
+			score = _mm512_mask_blend_epi64(whiteWins, score, loss);
+			score = _mm512_mask_blend_epi64(blackWins, score, win);
+			if (p == PLAYER_WHITE) score = _mm512_sub_epi64(zero, score);
+			_mm256_storeu_si256((__m256i*)(scores + i), _mm512_cvtepi64_epi32(score));
+		}
+		EvaluateScalar(t, p, states + i, count - i, scores + i);
+	}
+#endif
+
+	static void CpuId(int leaf, int sub, unsigned regs[4]) {
+#ifdef _MSC_VER
+		int r[4];
+		__cpuidex(r, leaf, sub);
+		for (int i = 0; i < 4; i++) regs[i] = (unsigned)r[i];
+#else
+		__cpuid_count(leaf, sub, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	// Register state the OS saves on context switches
+	static uint64_t EnabledXState() {
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		unsigned lo, hi;
+		__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		return ((uint64_t)hi << 32) | lo;
+#endif
+	}
+#endif
+
+	static bool DetectSupport(Backend b) {
+		if (b == BACKEND_SCALAR) return true;
+#ifdef LEAF_X86
+		unsigned regs[4];
+		CpuId(0, 0, regs);
+		if (regs[0] < 7) return false;
+		CpuId(1, 0, regs);
+		bool osxsave = !!(regs[2] & (1u << 27));
+		bool avx = !!(regs[2] & (1u << 28));
+		if (!osxsave || !avx) return false;
+		uint64_t xstate = EnabledXState();
+		CpuId(7, 0, regs);
+		// YMM state, and for AVX-512 the opmask and ZMM state too
+		bool avx2 = !!(regs[1] & (1u << 5)) && (xstate & 0x6) == 0x6;
+		if (b == BACKEND_AVX2) return avx2;
+#ifdef LEAF_AVX512
+		bool avx512 = avx2 && !!(regs[1] & (1u << 16)) && (xstate & 0xE6) == 0xE6;
+		if (b == BACKEND_AVX512) return avx512;
+#endif
+#endif
+		return false;
+	}
+
+	static EvalFunction Function(Backend b) {
+		switch (b) {
+#ifdef LEAF_X86
+		case BACKEND_AVX2: return EvaluateAVX2;
+#ifdef LEAF_AVX512
+		case BACKEND_AVX512: return EvaluateAVX512;
+#endif
+#endif
+		default: return EvaluateScalar;
+		}
+	}
+
+	Backend Detect() {
+		static const Backend best =
+			DetectSupport(BACKEND_AVX512) ? BACKEND_AVX512 :
+			DetectSupport(BACKEND_AVX2) ? BACKEND_AVX2 :
+			BACKEND_SCALAR;
+		return best;
+	}
+
+	bool Supported(Backend b) {
+		return b >= 0 && b < BACKEND_COUNT && DetectSupport(b);
+	}
+
+	static Backend active = Detect();
+	static EvalFunction activeFunction = Function(active);
+
+	Backend Active() {
+		return active;
+	}
+
+	bool SetBackend(Backend b) {
+		if (!Supported(b)) return false;
+		active = b;
+		activeFunction = Function(b);
+		return true;
+	}
+
+	const char* BackendName(Backend b) {
+		switch (b) {
+		case BACKEND_SCALAR: return "scalar";
+		case BACKEND_AVX2: return "AVX2";
+		case BACKEND_AVX512: return "AVX-512";
+		default: return "";
+		}
+	}
+
+	void Evaluate(const EvalTables& tables, Player p, const GameState* states, int count, int* scores) {
+		activeFunction(tables, p, states, count, scores);
+	}
+}
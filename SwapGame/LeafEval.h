@@ -0,0 +1,17 @@
+#pragma once
+#include "Evaluation.h"
+#include "GameStates.h"
+
+// Evaluates many leaf positions at once. Every backend returns exactly what
+// AI::Heuristic would for each state, including the win test.
+namespace LeafEval {
+	enum Backend { BACKEND_SCALAR, BACKEND_AVX2, BACKEND_AVX512, BACKEND_COUNT };
+	// Fastest backend the CPU and OS support; used unless overridden
+	Backend Detect();
+	bool Supported(Backend b);
+	Backend Active();
+	// Returns false, leaving the active backend alone, if b is unsupported
+	bool SetBackend(Backend b);
+	const char* BackendName(Backend b);
+	void Evaluate(const EvalTables& tables, Player p, const GameState* states, int count, int* scores);
+}
@@ -12,8 +12,25 @@ NineSlice::NineSlice(SDL_Texture* tex, int bX, int bY,
 
 NineSlice::~NineSlice() { }
 
-void NineSlice::RenderRect(SDL_Renderer* r, int x, int y, int w, int h) const {
-	SDL_Rect src, dest;
+static inline void AddPiece(NineSlice::Geometry& g,
+	int sx, int sy, int sw, int sh,
+	int dx, int dy, int dw, int dh) {
+	if (dw <= 0 || dh <= 0) return;
+	SDL_Rect& src = g.src[g.count];
+	SDL_Rect& dest = g.dest[g.count];
+	src.x = sx;
+	src.y = sy;
+	src.w = sw;
+	src.h = sh;
+	dest.x = dx;
+	dest.y = dy;
+	dest.w = dw;
+	dest.h = dh;
+	g.count++;
+}
+
+void NineSlice::ComputeGeometry(int x, int y, int w, int h, Geometry& g) const {
+	g.count = 0;
 	if (w <= 0) return;
 	if (h <= 0) return;
 	// Compute sizes of corners
@@ -29,104 +46,58 @@ void NineSlice::RenderRect(SDL_Renderer* r, int x, int y, int w, int h) const {
 	int ty = y + th;
 	int rx = x + w - rw;
 	int by = y + h - bh;
-	// Draw top-left corner
-	src.x = baseX;
-	src.y = baseY;
-	src.w = lw;
-	src.h = th;
-	dest.x = x;
-	dest.y = y;
-	dest.w = lw;
-	dest.h = th;
-	SDL_RenderCopy(r, Texture, &src, &dest);
-	
-	// Draw top edge
-	src.x = baseX + X1;
-	//src.y = baseY;
-	src.w = X2 - X1;
-	//src.h = th;
-	dest.x = lx;
-	//dest.y = y;
-	dest.w = remW;
-	//dest.h = th;
-	SDL_RenderCopy(r, Texture, &src, &dest);
-	
-	// Draw top-right corner
-	src.x = baseX + X3 - rw;
-	//src.y = baseY;
-	src.w = rw;
-	//src.h = th;
-	dest.x = rx;
-	//dest.y = y;
-	dest.w = rw;
-	//dest.h = th;
-	SDL_RenderCopy(r, Texture, &src, &dest);
-	
-	// Draw left edge
-	src.x = baseX;
-	src.y = baseY + Y1;
-	src.w = lw;
-	src.h = Y2 - Y1;
-	dest.x = x;
-	dest.y = ty;
-	dest.w = lw;
-	dest.h = remH;
-	SDL_RenderCopy(r, Texture, &src, &dest);
-	
-	// Draw center
-	src.x = baseX + X1;
-	//src.y = baseY + Y1;
-	src.w = X2 - X1;
-	//src.h = Y2 - Y1;
-	dest.x = lx;
-	//dest.y = ty;
-	dest.w = remW;
-	//dest.h = remH;
-	SDL_RenderCopy(r, Texture, &src, &dest);
-	
-	// Draw right edge
-	src.x = baseX + X3 - rw;
-	//src.y = baseY + Y1;
-	src.w = rw;
-	//src.h = Y2 - Y1;
-	dest.x = rx;
-	//dest.y = ty;
-	dest.w = rw;
-	//dest.h = remH;
-	SDL_RenderCopy(r, Texture, &src, &dest);
+	// Top-left corner, top edge, top-right corner
+	AddPiece(g, baseX, baseY, lw, th, x, y, lw, th);
+	AddPiece(g, baseX + X1, baseY, X2 - X1, th, lx, y, remW, th);
+	AddPiece(g, baseX + X3 - rw, baseY, rw, th, rx, y, rw, th);
+	// Left edge, center, right edge
+	AddPiece(g, baseX, baseY + Y1, lw, Y2 - Y1, x, ty, lw, remH);
+	AddPiece(g, baseX + X1, baseY + Y1, X2 - X1, Y2 - Y1, lx, ty, remW, remH);
+	AddPiece(g, baseX + X3 - rw, baseY + Y1, rw, Y2 - Y1, rx, ty, rw, remH);
+	// Bottom-left corner, bottom edge, bottom-right corner
+	AddPiece(g, baseX, baseY + Y3 - bh, lw, bh, x, by, lw, bh);
+	AddPiece(g, baseX + X1, baseY + Y3 - bh, X2 - X1, bh, lx, by, remW, bh);
+	AddPiece(g, baseX + X3 - rw, baseY + Y3 - bh, rw, bh, rx, by, rw, bh);
+}
 
-	// Draw bottom-left corner
-	src.x = baseX;
-	src.y = baseY + Y3 - bh;
-	src.w = lw;
-	src.h = bh;
-	dest.x = x;
-	dest.y = by;
-	dest.w = lw;
-	dest.h = bh;
-	SDL_RenderCopy(r, Texture, &src, &dest);
+const NineSlice::Geometry& NineSlice::GetGeometry(const SDL_Rect* rect) const {
+	for (int i = 0; i < cacheUsed; i++) {
+		const SDL_Rect& r = cache[i].rect;
+		if (r.x == rect->x && r.y == rect->y && r.w == rect->w && r.h == rect->h) {
+			return cache[i].geometry;
+		}
+	}
+	// Replace entries round-robin once the cache is full
+	CacheEntry& entry = cache[cacheNext];
+	cacheNext = (cacheNext + 1) % NINESLICE_CACHE_SIZE;
+	if (cacheUsed < NINESLICE_CACHE_SIZE) cacheUsed++;
+	entry.rect = *rect;
+	ComputeGeometry(rect->x, rect->y, rect->w, rect->h, entry.geometry);
+	return entry.geometry;
+}
 
-	// Draw bottom edge
-	src.x = baseX + X1;
-	//src.y = baseY + Y3 - bh;
-	src.w = X2 - X1;
-	//src.h = bh;
-	dest.x = lx;
-	//dest.y = by;
-	dest.w = remW;
-	//dest.h = bh;
-	SDL_RenderCopy(r, Texture, &src, &dest);
+void NineSlice::Draw(SpriteBatch& batch, const SDL_Rect* rect) const {
+	const Geometry& g = GetGeometry(rect);
+	for (int i = 0; i < g.count; i++) {
+		batch.Draw(Texture, &g.src[i], &g.dest[i]);
+	}
+}
+
+void NineSlice::Draw(SpriteBatch& batch, int x, int y, int w, int h) const {
+	SDL_Rect rect;
+	rect.x = x;
+	rect.y = y;
+	rect.w = w;
+	rect.h = h;
+	Draw(batch, &rect);
+}
 
-	// Draw bottom-right corner
-	src.x = baseX + X3 - rw;
-	//src.y = baseY + Y3 - bh;
-	src.w = rw;
-	//src.h = bh;
-	dest.x = rx;
-	//dest.y = by;
-	dest.w = rw;
-	//dest.h = bh;
-	SDL_RenderCopy(r, Texture, &src, &dest);
+void NineSlice::RenderRect(SDL_Renderer* r, int x, int y, int w, int h) const {
+	Geometry g;
+	ComputeGeometry(x, y, w, h, g);
+	for (int i = 0; i < g.count; i++) {
+		SDL_RenderCopy(r, Texture, &g.src[i], &g.dest[i]);
+	}
 }
 
 void NineSlice::RenderRect(SDL_Renderer* r, const SDL_Rect* rect) const {
@@ -1,8 +1,21 @@
 #pragma once
 #include <SDL.h>
 
+#include "SpriteBatch.h"
+
+// Rects whose geometry each nine-slice keeps. This must cover every rect one
+// nine-slice is drawn at in a frame, or cycling through them misses every
+// time; RoundedBG backs the three buttons and both clocks.
+#define NINESLICE_CACHE_SIZE 8
+
 class NineSlice {
 public:
+	// Source and destination quads for one rect; empty pieces are left out
+	struct Geometry {
+		SDL_Rect src[9];
+		SDL_Rect dest[9];
+		int count = 0;
+	};
 	SDL_Texture* Texture;
 	int baseX = 0, baseY = 0;
 	int X1 = 0, X2 = 0, X3 = 0;
@@ -10,6 +23,19 @@ public:
 	NineSlice();
 	NineSlice(SDL_Texture* tex, int bX, int bY, int x1, int x2, int x3, int y1, int y2, int y3);
 	~NineSlice();
+	void ComputeGeometry(int x, int y, int w, int h, Geometry& g) const;
+	// Geometry for a rect, reused while the same rect keeps being drawn
+	const Geometry& GetGeometry(const SDL_Rect* rect) const;
+	void Draw(SpriteBatch& batch, const SDL_Rect* rect) const;
+	void Draw(SpriteBatch& batch, int x, int y, int w, int h) const;
 	void RenderRect(SDL_Renderer* r, int x, int y, int w, int h) const;
 	void RenderRect(SDL_Renderer* r, const SDL_Rect* rect) const;
-};
\ No newline at end of file
+private:
+	struct CacheEntry {
+		SDL_Rect rect;
+		Geometry geometry;
+	};
+	mutable CacheEntry cache[NINESLICE_CACHE_SIZE];
+	mutable int cacheUsed = 0;
+	mutable int cacheNext = 0;
+};
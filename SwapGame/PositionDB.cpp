@@ -0,0 +1,269 @@
+// fopen is fine here; the secure variants are not portable
+#define _CRT_SECURE_NO_WARNINGS
+#include "PositionDB.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef _MSC_VER
+#define fseek64 _fseeki64
+#define ftell64 _ftelli64
+#else
+#define fseek64 fseeko
+#define ftell64 ftello
+#endif
+
+// Entries per block of a table; a lookup maps one block
+#define INDEX_BLOCK_ENTRIES 4096
+// Blocks whose fences are read through one view when opening
+#define INDEX_FENCE_VIEW_BLOCKS 256
+// Most move entries one key can have: every swap, plus INDEX_NO_MOVE
+#define INDEX_MOVES_PER_KEY ((BOARD_WIDTH - 1) * BOARD_HEIGHT + BOARD_WIDTH * (BOARD_HEIGHT - 1) + 1)
+
+static const char indexMagic[8] = { 'S', 'W', 'A', 'P', 'I', 'D', 'X', 0 };
+
+uint32_t PositionStats::Games() const {
+	return wins + losses + draws;
+}
+
+double PositionStats::Score() const {
+	uint32_t games = Games();
+	return games ? (wins + draws * 0.5) / games : 0.5;
+}
+
+uint64_t IndexKey(GameState s, Player toMove) {
+	return (uint64_t)s | (toMove == PLAYER_WHITE ? INDEX_WHITE_TO_MOVE : 0);
+}
+
+static void ReadExact(FILE* file, void* data, size_t size) {
+	if (fread(data, 1, size, file) != size) throw RecordError("Index file is truncated");
+}
+
+static void CheckHeader(const IndexHeader& header, uint64_t fileSize) {
+	if (memcmp(header.magic, indexMagic, sizeof(indexMagic)) != 0) throw RecordError("Not a position index");
+	if (header.version != INDEX_VERSION) throw RecordError("Unsupported index version");
+	if (header.byteOrder != INDEX_BYTE_ORDER) throw RecordError("Index was built on a machine with another byte order");
+	if (header.width != BOARD_WIDTH || header.height != BOARD_HEIGHT) throw RecordError("Index is for another board size");
+	if (header.positionsOffset != sizeof(IndexHeader) ||
+		header.movesOffset != header.positionsOffset + header.positionCount * sizeof(PositionEntry) ||
+		header.sourcesOffset != header.movesOffset + header.moveCount * sizeof(MoveEntry) ||
+		header.sourcesOffset > fileSize) {
+		throw RecordError("Index tables are corrupt");
+	}
+}
+
+void ReadIndexInfo(FILE* file, IndexHeader& header, vector<IndexSource>& sources) {
+	if (fseek64(file, 0, SEEK_END) != 0) throw RecordError("Cannot read index");
+	uint64_t fileSize = (uint64_t)ftell64(file);
+	rewind(file);
+	ReadExact(file, &header, sizeof(header));
+	CheckHeader(header, fileSize);
+	if (fseek64(file, header.sourcesOffset, SEEK_SET) != 0) throw RecordError("Cannot read index");
+	uint32_t count;
+	ReadExact(file, &count, sizeof(count));
+	sources.clear();
+	for (uint32_t i = 0; i < count; i++) {
+		IndexSource source;
+		uint32_t length;
+		ReadExact(file, &source.games, sizeof(source.games));
+		ReadExact(file, &length, sizeof(length));
+		source.path.resize(length);
+		if (length) ReadExact(file, &source.path[0], length);
+		sources.push_back(source);
+	}
+}
+
+// The platform handles keeping a file open for mapping
+struct PositionDB::Mapping {
+	uint64_t size = 0;
+	// Views must start at a multiple of this
+	uint64_t granularity = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE map = nullptr;
+#else
+	int fd = -1;
+#endif
+
+	Mapping(const string& path) {
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_FLAG_RANDOM_ACCESS, nullptr);
+		if (file == INVALID_HANDLE_VALUE) throw RecordError("Cannot open " + path);
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize)) {
+			Close();
+			throw RecordError("Cannot read " + path);
+		}
+		size = (uint64_t)fileSize.QuadPart;
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		granularity = info.dwAllocationGranularity;
+		if (size) map = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!map) {
+			Close();
+			throw RecordError("Cannot map " + path);
+		}
+#else
+		fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) throw RecordError("Cannot open " + path);
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			Close();
+			throw RecordError("Cannot read " + path);
+		}
+		size = (uint64_t)st.st_size;
+		granularity = (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+	}
+
+	~Mapping() {
+		Close();
+	}
+
+	void Close() {
+#ifdef _WIN32
+		if (map) CloseHandle(map);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		map = nullptr;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (fd >= 0) close(fd);
+		fd = -1;
+#endif
+	}
+};
+
+// Part of the file, mapped for as long as the view lives; data is null if
+// mapping failed
+struct PositionDB::View {
+	const uint8_t* data = nullptr;
+	void* base = nullptr;
+	size_t length = 0;
+
+	View(const Mapping& m, uint64_t offset, uint64_t size) {
+		if (size == 0 || offset + size > m.size) return;
+		uint64_t start = offset - offset % m.granularity;
+		length = (size_t)(offset + size - start);
+#ifdef _WIN32
+		base = MapViewOfFile(m.map, FILE_MAP_READ, (DWORD)(start >> 32), (DWORD)start, length);
+#else
+		base = mmap(nullptr, length, PROT_READ, MAP_SHARED, m.fd, (off_t)start);
+		if (base == MAP_FAILED) base = nullptr;
+#endif
+		if (base) data = (const uint8_t*)base + (offset - start);
+	}
+
+	~View() {
+		if (!base) return;
+#ifdef _WIN32
+		UnmapViewOfFile(base);
+#else
+		munmap(base, length);
+#endif
+	}
+};
+
+PositionDB::PositionDB(const string& path) : mapping(new Mapping(path)) {
+	try {
+		if (mapping->size < sizeof(IndexHeader)) throw RecordError("Index file is truncated");
+		IndexHeader header;
+		{
+			View view(*mapping, 0, sizeof(header));
+			if (!view.data) throw RecordError("Cannot map " + path);
+			memcpy(&header, view.data, sizeof(header));
+		}
+		CheckHeader(header, mapping->size);
+		positions.offset = header.positionsOffset;
+		positions.count = header.positionCount;
+		positions.entrySize = sizeof(PositionEntry);
+		moves.offset = header.movesOffset;
+		moves.count = header.moveCount;
+		moves.entrySize = sizeof(MoveEntry);
+		ReadFences(positions);
+		ReadFences(moves);
+	} catch (RecordError&) {
+		delete mapping;
+		throw;
+	}
+}
+
+PositionDB::~PositionDB() {
+	delete mapping;
+}
+
+void PositionDB::ReadFences(Table& table) {
+	uint64_t blocks = (table.count + INDEX_BLOCK_ENTRIES - 1) / INDEX_BLOCK_ENTRIES;
+	uint64_t blockBytes = INDEX_BLOCK_ENTRIES * table.entrySize;
+	table.fences.resize((size_t)blocks);
+	// Each view spans many blocks, but only the pages holding a fence are read
+	for (uint64_t b = 0; b < blocks; b += INDEX_FENCE_VIEW_BLOCKS) {
+		uint64_t end = min(blocks, b + INDEX_FENCE_VIEW_BLOCKS);
+		View view(*mapping, table.offset + b * blockBytes, (end - 1 - b) * blockBytes + sizeof(uint64_t));
+		if (!view.data) throw RecordError("Cannot map the index tables");
+		for (uint64_t i = b; i < end; i++) {
+			memcpy(&table.fences[(size_t)i], view.data + (i - b) * blockBytes, sizeof(uint64_t));
+		}
+	}
+}
+
+void PositionDB::FindBlock(const Table& table, uint64_t key, uint64_t extra, uint64_t& first, uint64_t& last) const {
+	// Every entry before the block of the last fence below key is below key
+	// too, and the entry at the next fence is not
+	uint64_t next = (uint64_t)(lower_bound(table.fences.begin(), table.fences.end(), key) - table.fences.begin());
+	first = next ? (next - 1) * INDEX_BLOCK_ENTRIES : 0;
+	last = min(table.count, next * INDEX_BLOCK_ENTRIES + extra);
+}
+
+uint64_t PositionDB::Positions() const {
+	return positions.count;
+}
+
+uint64_t PositionDB::Moves() const {
+	return moves.count;
+}
+
+bool PositionDB::Lookup(GameState s, Player toMove, PositionStats& stats) const {
+	uint64_t key = IndexKey(s, toMove);
+	uint64_t first, last;
+	FindBlock(positions, key, 1, first, last);
+	View view(*mapping, positions.offset + first * sizeof(PositionEntry), (last - first) * sizeof(PositionEntry));
+	if (!view.data) return false;
+	const PositionEntry* begin = (const PositionEntry*)view.data;
+	const PositionEntry* end = begin + (last - first);
+	const PositionEntry* e = lower_bound(begin, end, key,
+		[](const PositionEntry& a, uint64_t k) { return a.key < k; });
+	if (e == end || e->key != key) return false;
+	stats.wins = e->wins;
+	stats.losses = e->losses;
+	stats.draws = e->draws;
+	return true;
+}
+
+void PositionDB::NextMoves(GameState s, Player toMove, vector<MoveEntry>& result) const {
+	uint64_t key = IndexKey(s, toMove);
+	result.clear();
+	uint64_t first, last;
+	FindBlock(moves, key, INDEX_MOVES_PER_KEY, first, last);
+	View view(*mapping, moves.offset + first * sizeof(MoveEntry), (last - first) * sizeof(MoveEntry));
+	if (!view.data) return;
+	const MoveEntry* begin = (const MoveEntry*)view.data;
+	const MoveEntry* end = begin + (last - first);
+	const MoveEntry* e = lower_bound(begin, end, key,
+		[](const MoveEntry& a, uint64_t k) { return a.key < k; });
+	for (; e != end && e->key == key; e++) result.push_back(*e);
+	stable_sort(result.begin(), result.end(),
+		[](const MoveEntry& a, const MoveEntry& b) { return a.count > b.count; });
+}
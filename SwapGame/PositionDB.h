@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "GameRecord.h"
+#include "GameStates.h"
+
+// Index file layout, mapped straight into memory, so it is only portable
+// between hosts with the same byte order:
+//   IndexHeader
+//   Position table: PositionEntry sorted by key
+//   Move table: MoveEntry sorted by key, then move
+//   Sources: u32 count, then per record file: u64 games indexed,
+//     u32 path length, path bytes
+// A key is the state with INDEX_WHITE_TO_MOVE set when white is to move.
+#define INDEX_VERSION 1
+#define INDEX_BYTE_ORDER 0x01020304u
+#define INDEX_WHITE_TO_MOVE ((uint64_t)1 << 63)
+static_assert(BOARD_CELLS < 64, "INDEX_WHITE_TO_MOVE must not overlap a board cell");
+// Move byte of the final position of a game, which has no next move
+#define INDEX_NO_MOVE 0xFF
+
+struct IndexHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint8_t width;
+	uint8_t height;
+	uint16_t zero16;
+	uint32_t zero32;
+	uint64_t positionCount;
+	uint64_t moveCount;
+	uint64_t positionsOffset;
+	uint64_t movesOffset;
+	uint64_t sourcesOffset;
+};
+
+// Outcomes of the games that reached a position, for the side to move
+struct PositionEntry {
+	uint64_t key;
+	uint32_t wins;
+	uint32_t losses;
+	uint32_t draws;
+	uint32_t zero;
+};
+
+// How often a move was played from a position
+struct MoveEntry {
+	uint64_t key;
+	uint32_t count;
+	uint8_t move;
+	uint8_t zero[3];
+};
+
+static_assert(sizeof(IndexHeader) == 64, "IndexHeader must not be padded");
+static_assert(sizeof(PositionEntry) == 24, "PositionEntry must not be padded");
+static_assert(sizeof(MoveEntry) == 16, "MoveEntry must not be padded");
+
+struct PositionStats {
+	uint32_t wins = 0;
+	uint32_t losses = 0;
+	uint32_t draws = 0;
+	uint32_t Games() const;
+	// Share of the games the side to move went on to win, counting draws as half
+	double Score() const;
+};
+
+// Games of each record file an index already covers, by absolute path
+struct IndexSource {
+	std::string path;
+	uint64_t games;
+};
+
+uint64_t IndexKey(GameState s, Player toMove);
+// Reads and checks the header and source list of an index file without mapping it
+void ReadIndexInfo(FILE* file, IndexHeader& header, std::vector<IndexSource>& sources);
+
+// A read-only view of an index file. Lookups map only the block of a table
+// that can hold their key, so an index larger than a 32-bit address space
+// still opens, and they are safe from any number of threads.
+class PositionDB {
+public:
+	// Throws RecordError if the file is missing or malformed
+	PositionDB(const std::string& path);
+	~PositionDB();
+	PositionDB(const PositionDB&) = delete;
+	PositionDB& operator=(const PositionDB&) = delete;
+	uint64_t Positions() const;
+	uint64_t Moves() const;
+	// Returns false if no indexed game reached s with toMove to move
+	bool Lookup(GameState s, Player toMove, PositionStats& stats) const;
+	// Moves played from s with toMove to move, most played first
+	void NextMoves(GameState s, Player toMove, std::vector<MoveEntry>& moves) const;
+private:
+	struct Mapping;
+	struct View;
+	// A sorted table in the file, with the first key of every
+	// INDEX_BLOCK_ENTRIES entries kept in memory
+	struct Table {
+		uint64_t offset = 0;
+		uint64_t count = 0;
+		uint64_t entrySize = 0;
+		std::vector<uint64_t> fences;
+	};
+	Mapping* mapping;
+	Table positions;
+	Table moves;
+	void ReadFences(Table& table);
+	// Entries [first, last) hold the first entry with key, if there is one,
+	// and up to extra - 1 entries after it
+	void FindBlock(const Table& table, uint64_t key, uint64_t extra, uint64_t& first, uint64_t& last) const;
+};
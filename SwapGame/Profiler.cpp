@@ -0,0 +1,184 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Profiler.h"
+
+#ifdef SWAPGAME_PROFILE
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace Profiler {
+	struct Event {
+		const char* name;
+		int64_t start;
+		int64_t duration;
+	};
+
+	struct Window {
+		int64_t samples[PROFILE_WINDOW];
+		int count = 0;
+	};
+
+	struct ThreadData {
+		int id;
+		string name;
+		// Guards against readers; only ever contended while a dump is running
+		mutex lock;
+		vector<Event> events;
+		uint64_t recorded = 0;
+		unordered_map<const char*, Window> windows;
+		// The owning thread has exited and a new one may take the buffers over
+		bool free = false;
+	};
+
+	static mutex registryLock;
+	static vector<unique_ptr<ThreadData>> threads;
+
+	static int64_t Now() {
+		return chrono::duration_cast<chrono::nanoseconds>(
+			chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Hands a thread's data back to the registry when the thread exits
+	struct ThreadSlot {
+		ThreadData* data = nullptr;
+		~ThreadSlot() {
+			if (!data) return;
+			lock_guard<mutex> lock(registryLock);
+			data->free = true;
+		}
+	};
+
+	static ThreadData& CurrentThread() {
+		// Thread data outlives its thread so events can still be dumped, and is
+		// reused by later threads so a thread per search does not add a buffer
+		// and a timeline every move
+		thread_local ThreadSlot slot;
+		if (!slot.data) {
+			lock_guard<mutex> lock(registryLock);
+			for (auto& t : threads) {
+				if (t->free) {
+					slot.data = t.get();
+					break;
+				}
+			}
+			if (!slot.data) {
+				threads.emplace_back(new ThreadData());
+				slot.data = threads.back().get();
+				slot.data->id = (int)threads.size();
+				slot.data->name = "Thread " + to_string(slot.data->id);
+				slot.data->events.resize(PROFILE_EVENTS);
+			}
+			slot.data->free = false;
+		}
+		return *slot.data;
+	}
+
+	Scope::Scope(const char* n) : name(n), start(Now()) { }
+
+	Scope::~Scope() {
+		int64_t duration = Now() - start;
+		ThreadData& t = CurrentThread();
+		lock_guard<mutex> lock(t.lock);
+		Event& e = t.events[t.recorded % PROFILE_EVENTS];
+		e.name = name;
+		e.start = start;
+		e.duration = duration;
+		t.recorded++;
+		Window& w = t.windows[name];
+		w.samples[w.count % PROFILE_WINDOW] = duration;
+		w.count++;
+	}
+
+	void SetThreadName(const char* name) {
+		ThreadData& t = CurrentThread();
+		lock_guard<mutex> lock(t.lock);
+		t.name = name;
+	}
+
+	static void WriteJsonString(FILE* f, const string& s) {
+		fputc('"', f);
+		for (char c : s) {
+			if (c == '"' || c == '\\') fputc('\\', f);
+			if ((unsigned char)c >= 0x20) fputc(c, f);
+		}
+		fputc('"', f);
+	}
+
+	bool WriteChromeTrace(const string& path) {
+		FILE* f = fopen(path.c_str(), "w");
+		if (!f) return false;
+		fprintf(f, "{\"traceEvents\":[\n");
+		bool first = true;
+		lock_guard<mutex> registry(registryLock);
+		for (auto& t : threads) {
+			lock_guard<mutex> lock(t->lock);
+			fprintf(f, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+				first ? "" : ",\n", t->id);
+			WriteJsonString(f, t->name);
+			fprintf(f, "}}");
+			first = false;
+			uint64_t begin = t->recorded > PROFILE_EVENTS ? t->recorded - PROFILE_EVENTS : 0;
+			for (uint64_t i = begin; i < t->recorded; i++) {
+				const Event& e = t->events[i % PROFILE_EVENTS];
+				// Trace timestamps are in microseconds
+				fprintf(f, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"name\":",
+					t->id, e.start / 1000.0, e.duration / 1000.0);
+				WriteJsonString(f, e.name);
+				fputc('}', f);
+			}
+		}
+		fprintf(f, "\n]}\n");
+		bool ok = ferror(f) == 0;
+		return fclose(f) == 0 && ok;
+	}
+
+	// Recent durations of every scope across all threads, keyed by name
+	static map<string, vector<int64_t>> CollectSamples() {
+		map<string, vector<int64_t>> result;
+		lock_guard<mutex> registry(registryLock);
+		for (auto& t : threads) {
+			lock_guard<mutex> lock(t->lock);
+			for (auto& entry : t->windows) {
+				vector<int64_t>& samples = result[entry.first];
+				int n = min(entry.second.count, PROFILE_WINDOW);
+				samples.insert(samples.end(), entry.second.samples, entry.second.samples + n);
+			}
+		}
+		return result;
+	}
+
+	static double PercentileOf(vector<int64_t>& samples, double p) {
+		if (samples.empty()) return -1;
+		size_t i = (size_t)(p / 100.0 * (samples.size() - 1) + 0.5);
+		nth_element(samples.begin(), samples.begin() + i, samples.end());
+		return samples[i] / 1e6;
+	}
+
+	double Percentile(const char* name, double p) {
+		map<string, vector<int64_t>> all = CollectSamples();
+		auto found = all.find(name);
+		if (found == all.end()) return -1;
+		return PercentileOf(found->second, p);
+	}
+
+	void PrintSummary(ostream& out) {
+		map<string, vector<int64_t>> all = CollectSamples();
+		out << "Scope timings in ms (p50 / p95 / p99 / max over recent samples):" << endl;
+		for (auto& entry : all) {
+			out << "  " << entry.first << ": "
+				<< PercentileOf(entry.second, 50) << " / "
+				<< PercentileOf(entry.second, 95) << " / "
+				<< PercentileOf(entry.second, 99) << " / "
+				<< PercentileOf(entry.second, 100) << endl;
+		}
+	}
+}
+#endif
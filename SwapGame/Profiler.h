@@ -0,0 +1,44 @@
+#pragma once
+// Scoped instrumentation, compiled in only when SWAPGAME_PROFILE is defined.
+// Without it the macros expand to nothing and no profiler code is built.
+//
+// Each thread records complete events into its own ring buffer, so the most
+// recent PROFILE_EVENTS events survive for a trace dump after a stall, and
+// keeps the last PROFILE_WINDOW durations of every scope for percentiles.
+
+#ifdef SWAPGAME_PROFILE
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#define PROFILE_EVENTS (1 << 16)
+#define PROFILE_WINDOW 256
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+// Times the rest of the enclosing block; name must be a string literal
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define PROFILE_THREAD(name) Profiler::SetThreadName(name)
+
+namespace Profiler {
+	class Scope {
+	public:
+		Scope(const char* name);
+		~Scope();
+	private:
+		const char* name;
+		int64_t start;
+	};
+	void SetThreadName(const char* name);
+	// Writes the recorded events as Chrome trace-event JSON, for chrome://tracing or Perfetto
+	bool WriteChromeTrace(const std::string& path);
+	// Duration in milliseconds at percentile p (0 to 100) over the recent samples of
+	// a scope on every thread, or a negative value if the scope has not run
+	double Percentile(const char* name, double p);
+	// Median, 95th and 99th percentile and maximum of every scope
+	void PrintSummary(std::ostream& out);
+}
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_THREAD(name)
+#endif
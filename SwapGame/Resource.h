@@ -0,0 +1,4 @@
+#pragma once
+
+#define IDR_TEXTURE 101
+#define IDR_FONT 102
@@ -0,0 +1,107 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "GameStates.h"
+
+// Compile-time tables over the bits of one row (white = 1), or over two
+// neighbouring rows: a goal row in the low bits and the row next to it in the
+// high bits. They are generated from BOARD_WIDTH.
+#define ROW_PATTERNS (1 << BOARD_WIDTH)
+#define ROW_PAIR_PATTERNS (ROW_PATTERNS * ROW_PATTERNS)
+#define ROW_BITS (ROW_PATTERNS - 1)
+
+static_assert(BOARD_HEIGHT >= 4, "The goal-row pairs must not overlap");
+
+namespace RowTables {
+	constexpr int PopCount(unsigned v) {
+		return v ? (int)(v & 1) + PopCount(v >> 1) : 0;
+	}
+
+	// Adjacent pieces of one colour in a row; swapping them changes nothing,
+	// so they block sideways play
+	constexpr int WhitePairs(unsigned row) {
+		return PopCount(row & (row >> 1));
+	}
+	constexpr int BlackPairs(unsigned row) {
+		return WhitePairs(~row & ROW_BITS);
+	}
+
+	// Columns where one vertical swap brings a black piece into the top row
+	// in place of a white one; pair is the top row and the row below it
+	constexpr unsigned BlackOneSwapColumns(unsigned pair) {
+		return pair & ~(pair >> BOARD_WIDTH) & ROW_BITS;
+	}
+	// Columns where one vertical swap brings a white piece into the bottom
+	// row in place of a black one; pair is the bottom row and the row above it
+	constexpr unsigned WhiteOneSwapColumns(unsigned pair) {
+		return ~pair & (pair >> BOARD_WIDTH) & ROW_BITS;
+	}
+	constexpr int BlackOneSwap(unsigned pair) {
+		return PopCount(BlackOneSwapColumns(pair));
+	}
+	constexpr int WhiteOneSwap(unsigned pair) {
+		return PopCount(WhiteOneSwapColumns(pair));
+	}
+
+	constexpr int LowestBit(unsigned v, int i) {
+		return (v >> i) & 1 ? i : LowestBit(v, i + 1);
+	}
+	// Column of the swap that wins at once, or -1. Horizontal swaps never
+	// change a row's count, so only a vertical swap can complete a goal row.
+	constexpr int BlackWinningColumn(unsigned pair) {
+		return PopCount(pair & ROW_BITS) == 1 && BlackOneSwap(pair) == 1 ? LowestBit(pair, 0) : -1;
+	}
+	constexpr int WhiteWinningColumn(unsigned pair) {
+		return PopCount(~pair & ROW_BITS) == 1 && WhiteOneSwap(pair) == 1 ? LowestBit(~pair & ROW_BITS, 0) : -1;
+	}
+
+	typedef int (*PatternFunction)(unsigned);
+	template <PatternFunction F, std::size_t... I>
+	constexpr std::array<int8_t, sizeof...(I)> MakeTable(std::index_sequence<I...>) {
+		return {{ (int8_t)F((unsigned)I)... }};
+	}
+	template <PatternFunction F, std::size_t N>
+	constexpr std::array<int8_t, N> MakeTable() {
+		return MakeTable<F>(std::make_index_sequence<N>());
+	}
+
+	// Indexed by one row
+	constexpr std::array<int8_t, ROW_PATTERNS> WhiteCount = MakeTable<PopCount, ROW_PATTERNS>();
+	constexpr std::array<int8_t, ROW_PATTERNS> WhitePairCount = MakeTable<WhitePairs, ROW_PATTERNS>();
+	constexpr std::array<int8_t, ROW_PATTERNS> BlackPairCount = MakeTable<BlackPairs, ROW_PATTERNS>();
+	// Indexed by a goal row and its neighbour
+	constexpr std::array<int8_t, ROW_PAIR_PATTERNS> BlackOneSwapCount = MakeTable<BlackOneSwap, ROW_PAIR_PATTERNS>();
+	constexpr std::array<int8_t, ROW_PAIR_PATTERNS> WhiteOneSwapCount = MakeTable<WhiteOneSwap, ROW_PAIR_PATTERNS>();
+	constexpr std::array<int8_t, ROW_PAIR_PATTERNS> BlackWinColumn = MakeTable<BlackWinningColumn, ROW_PAIR_PATTERNS>();
+	constexpr std::array<int8_t, ROW_PAIR_PATTERNS> WhiteWinColumn = MakeTable<WhiteWinningColumn, ROW_PAIR_PATTERNS>();
+
+	static_assert(WhiteCount[ROW_BITS] == BOARD_WIDTH, "Row counts are wrong");
+	static_assert(BlackPairCount[0] == BOARD_WIDTH - 1, "Pair counts are wrong");
+	static_assert(BlackWinColumn[1] == 0 && BlackWinColumn[1 | 1 << BOARD_WIDTH] == -1, "Black win test is wrong");
+	static_assert(WhiteWinColumn[(ROW_BITS - 2) | ROW_BITS << BOARD_WIDTH] == 1, "White win test is wrong");
+
+	inline unsigned Row(GameState s, int y) {
+		return (unsigned)(s >> (y * BOARD_WIDTH)) & ROW_BITS;
+	}
+	// Top row with the row below it
+	inline unsigned TopPair(GameState s) {
+		return Row(s, 0) | Row(s, 1) << BOARD_WIDTH;
+	}
+	// Bottom row with the row above it
+	inline unsigned BottomPair(GameState s) {
+		return Row(s, BOARD_HEIGHT - 1) | Row(s, BOARD_HEIGHT - 2) << BOARD_WIDTH;
+	}
+
+	// Finds a swap, always vertical, that wins for p at once. Winning states
+	// end the game, so they can never repeat an earlier one and the swap is
+	// always legal.
+	inline bool WinningSwap(GameState s, Player p, int& swapPos) {
+		int x = p == PLAYER_BLACK ? BlackWinColumn[TopPair(s)] : WhiteWinColumn[BottomPair(s)];
+		if (x < 0) return false;
+		swapPos = p == PLAYER_BLACK ? x : (BOARD_HEIGHT - 2) * BOARD_WIDTH + x;
+		return true;
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <memory>
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+
+#define DECLARE_DELETER(c, d) struct c##_Deleter { void operator()(c* r) { if (r) d(r); } }
+
+DECLARE_DELETER(SDL_Renderer, SDL_DestroyRenderer);
+DECLARE_DELETER(SDL_Window, SDL_DestroyWindow);
+DECLARE_DELETER(SDL_Surface, SDL_FreeSurface);
+DECLARE_DELETER(SDL_Texture, SDL_DestroyTexture);
+DECLARE_DELETER(TTF_Font, TTF_CloseFont);
+
+#define SAFEPTR(x) std::unique_ptr<x, x##_Deleter>
+#define MAKESAFE(t, v) std::unique_ptr<t, t##_Deleter> v##_P(v)
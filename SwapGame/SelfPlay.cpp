@@ -0,0 +1,81 @@
+#include "SelfPlay.h"
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "AI.h"
+
+using namespace std;
+
+static void PlayGame(const SelfPlayOptions& options, mt19937& rng, GameRecord& rec) {
+	vector<uint8_t> legal;
+	unordered_set<GameState> seen;
+	rec.Clear();
+	rec.start = (1LL << (BOARD_HEIGHT / 2 * BOARD_WIDTH)) - 1;
+	rec.firstPlayer = PLAYER_WHITE;
+	rec.whiteIsAI = true;
+	rec.blackIsAI = true;
+	GameState s = rec.start;
+	seen.insert(s);
+	Player player = rec.firstPlayer;
+	for (int ply = 0; ply < options.maxMoves && GetWinner(s) == PLAYER_NONE; ply++) {
+		legal.clear();
+		for (int pos = 0; pos < BOARD_CELLS; pos++) {
+			for (int v = 0; v < 2; v++) {
+				int swapPos;
+				bool vertical;
+				uint8_t m = EncodeMove(pos, !!v);
+				if (DecodeMove(m, swapPos, vertical) && !seen.count(PerformSwap(s, swapPos, vertical))) {
+					legal.push_back(m);
+				}
+			}
+		}
+		// A player with no legal move ends the game undecided
+		if (legal.empty()) break;
+		int swapPos;
+		bool vertical;
+		if (ply < options.randomPlies || uniform_real_distribution<double>()(rng) < options.randomMoveChance) {
+			DecodeMove(legal[rng() % legal.size()], swapPos, vertical);
+		} else {
+			AI::ComputeMove(s, seen, player, swapPos, vertical);
+		}
+		s = PerformSwap(s, swapPos, vertical);
+		seen.insert(s);
+		rec.moves.push_back(EncodeMove(swapPos, vertical));
+		player = OtherPlayer(player);
+	}
+	rec.winner = GetWinner(s);
+}
+
+void SelfPlay(const SelfPlayOptions& options, GameRecordWriter& out) {
+	int threads = options.threads > 0 ? options.threads : (int)thread::hardware_concurrency();
+	if (threads < 1) threads = 1;
+	atomic<int> nextGame(0);
+	mutex outLock;
+	int wins[3] = { 0, 0, 0 };
+	auto worker = [&]() {
+		GameRecord rec;
+		for (;;) {
+			int game = nextGame++;
+			if (game >= options.games) break;
+			// Seeded per game, so which thread plays it does not matter
+			mt19937 rng(options.seed * 7919u + (unsigned)game);
+			PlayGame(options, rng, rec);
+			lock_guard<mutex> lock(outLock);
+			out.Write(rec);
+			wins[rec.winner]++;
+			if ((game + 1) % 1000 == 0) cout << "Played " << (game + 1) << " games" << endl;
+		}
+	};
+	vector<thread> pool;
+	for (int i = 0; i < threads; i++) pool.emplace_back(worker);
+	for (thread& t : pool) t.join();
+	out.Flush();
+	cout << "Self-play: " << options.games << " games, black won " << wins[PLAYER_BLACK]
+		<< ", white won " << wins[PLAYER_WHITE] << ", undecided " << wins[PLAYER_NONE] << endl;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "GameRecord.h"
+
+struct SelfPlayOptions {
+	int games = 1000;
+	// Uniformly random moves at the start of each game, so games differ
+	int randomPlies = 4;
+	// Chance that any later move is random too. The search defends well
+	// enough that games between two unperturbed CPUs almost never finish.
+	double randomMoveChance = 0.5;
+	// Games still undecided after this many moves are recorded without a winner
+	int maxMoves = 2000;
+	int threads = 0;
+	// The same seed plays the same games, though several threads may write
+	// them in a different order
+	unsigned seed = 1;
+};
+
+// Plays CPU against CPU from the standard start position, appending every game to out
+void SelfPlay(const SelfPlayOptions& options, GameRecordWriter& out);
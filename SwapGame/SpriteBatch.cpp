@@ -0,0 +1,130 @@
+#include "SpriteBatch.h"
+
+#include "Profiler.h"
+
+using namespace std;
+
+SpriteBatch::SpriteBatch(SDL_Renderer* r) : renderer(r) {
+	color.r = color.g = color.b = color.a = 255;
+}
+
+SpriteBatch::~SpriteBatch() { }
+
+SDL_Renderer* SpriteBatch::Renderer() const {
+	return renderer;
+}
+
+void SpriteBatch::SetColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+	color.r = r;
+	color.g = g;
+	color.b = b;
+	color.a = a;
+}
+
+void SpriteBatch::SetClipRect(const SDL_Rect* rect) {
+	Flush();
+	clipped = rect != nullptr;
+	if (clipped) clip = *rect;
+	SDL_RenderSetClipRect(renderer, rect);
+}
+
+void SpriteBatch::Draw(SDL_Texture* tex, const SDL_Rect* src, const SDL_Rect* dest) {
+	if (dest->w <= 0 || dest->h <= 0) return;
+	if (clipped && !SDL_HasIntersection(dest, &clip)) return;
+	if (tex != texture) {
+		Flush();
+		texture = tex;
+		SDL_QueryTexture(tex, nullptr, nullptr, &textureW, &textureH);
+	}
+	Quad q;
+	if (src) {
+		q.src = *src;
+	} else {
+		q.src.x = 0;
+		q.src.y = 0;
+		q.src.w = textureW;
+		q.src.h = textureH;
+	}
+	q.dest = *dest;
+	q.color = color;
+	quads.push_back(q);
+	quadCount++;
+}
+
+void SpriteBatch::Flush() {
+	// Once flushed the texture may be freed and its address reused by a new
+	// one, so the next Draw must query whatever it is given
+	if (quads.empty()) {
+		texture = nullptr;
+		return;
+	}
+	PROFILE_SCOPE("SpriteBatch::Flush");
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	// One indexed triangle list for the whole run; the tint travels in the vertices
+	vertices.clear();
+	indices.clear();
+	const float iw = 1.0f / textureW;
+	const float ih = 1.0f / textureH;
+	for (const Quad& q : quads) {
+		const int base = (int)vertices.size();
+		const float x0 = (float)q.dest.x, x1 = (float)(q.dest.x + q.dest.w);
+		const float y0 = (float)q.dest.y, y1 = (float)(q.dest.y + q.dest.h);
+		const float u0 = q.src.x * iw, u1 = (q.src.x + q.src.w) * iw;
+		const float v0 = q.src.y * ih, v1 = (q.src.y + q.src.h) * ih;
+		SDL_Vertex v;
+		v.color = q.color;
+		v.position.x = x0; v.position.y = y0; v.tex_coord.x = u0; v.tex_coord.y = v0;
+		vertices.push_back(v);
+		v.position.x = x1; v.tex_coord.x = u1;
+		vertices.push_back(v);
+		v.position.y = y1; v.tex_coord.y = v1;
+		vertices.push_back(v);
+		v.position.x = x0; v.tex_coord.x = u0;
+		vertices.push_back(v);
+		indices.push_back(base);
+		indices.push_back(base + 1);
+		indices.push_back(base + 2);
+		indices.push_back(base);
+		indices.push_back(base + 2);
+		indices.push_back(base + 3);
+	}
+	SDL_SetTextureColorMod(texture, 255, 255, 255);
+	SDL_SetTextureAlphaMod(texture, 255);
+	SDL_RenderGeometry(renderer, texture, vertices.data(), (int)vertices.size(),
+		indices.data(), (int)indices.size());
+	drawCalls++;
+#else
+	// No geometry API: fall back to one copy per quad, only touching the colour
+	// mod when the tint actually changes
+	SDL_Color current = quads[0].color;
+	SDL_SetTextureColorMod(texture, current.r, current.g, current.b);
+	SDL_SetTextureAlphaMod(texture, current.a);
+	for (const Quad& q : quads) {
+		if (q.color.r != current.r || q.color.g != current.g ||
+			q.color.b != current.b || q.color.a != current.a) {
+			current = q.color;
+			SDL_SetTextureColorMod(texture, current.r, current.g, current.b);
+			SDL_SetTextureAlphaMod(texture, current.a);
+		}
+		SDL_RenderCopy(renderer, texture, &q.src, &q.dest);
+		drawCalls++;
+	}
+	SDL_SetTextureColorMod(texture, 255, 255, 255);
+	SDL_SetTextureAlphaMod(texture, 255);
+#endif
+	quads.clear();
+	texture = nullptr;
+}
+
+int SpriteBatch::DrawCalls() const {
+	return drawCalls;
+}
+
+int SpriteBatch::Quads() const {
+	return quadCount;
+}
+
+void SpriteBatch::ResetStats() {
+	drawCalls = 0;
+	quadCount = 0;
+}
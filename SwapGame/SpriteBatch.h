@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+
+#include <SDL.h>
+
+// Collects textured quads and submits each run that shares a texture in as few
+// draw calls as the renderer allows. Anything that changes renderer state
+// (clip rect, render target, texture colour mod) must be preceded by Flush().
+class SpriteBatch {
+public:
+	SpriteBatch(SDL_Renderer* r);
+	~SpriteBatch();
+	SDL_Renderer* Renderer() const;
+	// Sets the tint applied to quads added after this call
+	void SetColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a = SDL_ALPHA_OPAQUE);
+	// Flushes, then sets the renderer's clip rect; quads entirely outside it
+	// are dropped instead of queued. Pass nullptr to clear it.
+	void SetClipRect(const SDL_Rect* rect);
+	void Draw(SDL_Texture* tex, const SDL_Rect* src, const SDL_Rect* dest);
+	void Flush();
+	// Number of draw calls issued since the last ResetStats()
+	int DrawCalls() const;
+	int Quads() const;
+	void ResetStats();
+private:
+	struct Quad {
+		SDL_Rect src, dest;
+		SDL_Color color;
+	};
+	SDL_Renderer* renderer;
+	SDL_Texture* texture = nullptr;
+	int textureW = 0, textureH = 0;
+	SDL_Color color;
+	SDL_Rect clip;
+	bool clipped = false;
+	std::vector<Quad> quads;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	std::vector<SDL_Vertex> vertices;
+	std::vector<int> indices;
+#endif
+	int drawCalls = 0;
+	int quadCount = 0;
+};
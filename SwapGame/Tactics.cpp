@@ -0,0 +1,181 @@
+#include "Tactics.h"
+
+#include <climits>
+#include <iostream>
+#include <unordered_set>
+#include <vector>
+
+#include "AI.h"
+#include "Timing.h"
+
+using namespace std;
+
+struct TacticsPosition {
+	Player toMove;
+	// Top row first, 'W' for a white piece
+	const char* rows[BOARD_HEIGHT];
+};
+
+static_assert(BOARD_WIDTH == 6 && BOARD_HEIGHT == 6, "The tactics suite is drawn for a 6x6 board");
+
+// Two positions set up by hand, then ones where a depth 3 search without
+// the extension and a depth 5 search disagreed
+static const TacticsPosition Mined[] = {
+	// Black empties the top row with one swap
+	{ PLAYER_BLACK, { "W.....", "......", "WW..WW", "W.WW.W", "WWW.WW", "WW.WWW" } },
+	// White fills the bottom row next unless black stops it
+	{ PLAYER_BLACK, { ".W..W.", "......", "W.W..W", "..WW..", "W...W.", "WWWW.W" } },
+	{ PLAYER_BLACK, { "..W.W.", "......", "WW.WWW", "W....W", ".WW..W", "..WWW." } },
+	{ PLAYER_BLACK, { "..W...", "..W.W.", ".....W", "WW...W", ".WWWWW", ".WWWWW" } },
+	{ PLAYER_BLACK, { "W...W.", "..W..W", "WW.W.W", "WWW.WW", ".WWWWW", "WWW.WW" } },
+	{ PLAYER_BLACK, { ".W...W", "......", ".W..WW", "W.W...", "WW.WWW", "WW.WWW" } },
+	{ PLAYER_BLACK, { "...W.W", "..W.W.", ".W.W..", "..W..W", "WW.WWW", ".WWWWW" } },
+	{ PLAYER_BLACK, { ".W....", ".W..W.", "..WW..", ".W.WWW", "WW.WWW", "W..W.W" } },
+	{ PLAYER_BLACK, { "....W.", "W...W.", ".W.W.W", "WWW..W", "WWW.WW", "WWW.WW" } },
+	{ PLAYER_BLACK, { "...W..", "...W.W", "W.W.W.", "W..WWW", "W.WWWW", "W.WWW." } },
+	{ PLAYER_BLACK, { "W..W..", "W....W", "WW....", ".W.WWW", "WWWWWW", "WWW.W." } },
+	{ PLAYER_WHITE, { ".W....", ".W.WW.", "...W.W", ".WWWWW", "W.W.WW", "WWW.WW" } },
+	{ PLAYER_WHITE, { ".....W", "..W...", ".W..WW", "..W.WW", "..WWWW", "W.WWWW" } },
+	{ PLAYER_WHITE, { ".W.W..", "......", ".WW.W.", "W.W..W", "W...WW", "WWW..W" } },
+	{ PLAYER_WHITE, { "W...W.", "......", "W..W.W", ".WWW.W", "WWWWW.", "WW.W.." } },
+	{ PLAYER_WHITE, { "..W...", "..W...", "WW.W..", "WW.WW.", "W..WW.", "..WW.." } },
+	{ PLAYER_WHITE, { "W..W..", ".....W", "W...WW", ".W.WWW", "W.W.WW", "WWW.WW" } },
+	{ PLAYER_WHITE, { ".W....", ".....W", ".W..W.", "WW.W..", "W.WWW.", ".WWW.W" } },
+};
+
+// Picked without running either search: every 20th game of
+//   SwapGame --selfplay 400 tune400.swr --seed 20261019
+// taken 2 to 9 plies before its end, cycling through the offsets
+static const TacticsPosition Sampled[] = {
+	{ PLAYER_BLACK, { "W.WWW.", "..WW.W", "WW....", ".....W", "W...WW", ".WWWWW" } },
+	{ PLAYER_BLACK, { ".WW...", "W...WW", "W.WWWW", "W.W.W.", ".W...W", "WW..W." } },
+	{ PLAYER_WHITE, { "..W...", ".W..W.", "W.WWWW", "WW..WW", "..W.W.", "WWWW.." } },
+	{ PLAYER_BLACK, { "...W..", "WW.WWW", "WWW.W.", "W.WW..", ".W.WW.", "...W.W" } },
+	{ PLAYER_BLACK, { "W.WWWW", ".WWWWW", ".....W", "......", "..WW..", "WWWW.W" } },
+	{ PLAYER_BLACK, { "..WWWW", "WW....", "...W.W", "WWW..W", "..WW..", "WWWW.." } },
+	{ PLAYER_WHITE, { ".....W", "WW.W.W", ".WWWWW", "W.W.W.", "WWW..W", "....W." } },
+	{ PLAYER_BLACK, { ".W.W..", ".WW...", ".WWWWW", "WWW..W", ".W...W", ".W.W.W" } },
+	{ PLAYER_BLACK, { "W..W..", "..W...", ".W.WW.", "WW.W.W", "W.W..W", ".WWWWW" } },
+	{ PLAYER_BLACK, { ".W.W..", "WWW..W", "W.W.WW", "W.W.W.", "WW...W", "W.W..." } },
+	{ PLAYER_WHITE, { "...W.W", ".WWW..", ".WW..W", "WWW.WW", "..W.W.", "...WWW" } },
+	{ PLAYER_BLACK, { "W.....", "W.WW.W", "W..WW.", "..WWWW", ".WWW.W", ".W...W" } },
+	{ PLAYER_BLACK, { "....W.", "WW.W.W", "..WWWW", "....W.", "WW...W", "WW.WWW" } },
+	{ PLAYER_WHITE, { "..WWWW", ".W.W.W", "WW.WWW", "......", ".W..W.", "WW.W.W" } },
+	{ PLAYER_BLACK, { "W.WWW.", ".W..W.", ".WW...", "WWW...", "..WW..", "WW.WWW" } },
+	{ PLAYER_BLACK, { "WW.W..", ".WWW.W", "..WW..", "W.WWW.", "..W.WW", "..W.W." } },
+	{ PLAYER_BLACK, { "W..WWW", "..WWW.", ".W....", "..W.WW", "WW....", ".WWWWW" } },
+	{ PLAYER_BLACK, { "W..W..", ".WW.WW", "..WWWW", ".W.W..", "WW..W.", "W.WW.." } },
+	{ PLAYER_WHITE, { "..W...", "W.WW..", "WW.WWW", "WWWW..", ".W...W", "W.WW.." } },
+	{ PLAYER_WHITE, { "WW.WWW", ".W...W", "......", "W.W.W.", ".W.WWW", "W.WW.W" } },
+};
+
+struct TacticsGroup {
+	const char* name;
+	const TacticsPosition* positions;
+	int count;
+	// Positions a plain search gets right with the shipped weights; the mined
+	// ones were chosen where it went wrong, so it is not expected to get all
+	int plainBaseline;
+};
+
+static const TacticsGroup Groups[] = {
+	{ "Mined", Mined, sizeof(Mined) / sizeof(Mined[0]), 13 },
+	{ "Sampled", Sampled, sizeof(Sampled) / sizeof(Sampled[0]), 20 },
+};
+
+static GameState Parse(const TacticsPosition& p) {
+	GameState s = 0;
+	for (int y = 0; y < BOARD_HEIGHT; y++) {
+		for (int x = 0; x < BOARD_WIDTH; x++) {
+			int pos = y * BOARD_WIDTH + x;
+			if (p.rows[y][x] == 'W') s |= STATE_BIT(pos);
+		}
+	}
+	return s;
+}
+
+// A move is sound if it wins when some move does, and otherwise does not
+// lose when some move holds
+static bool Sound(int value, int best) {
+	if (best >= EVAL_WIN) return value >= EVAL_WIN;
+	if (best > -EVAL_WIN) return value > -EVAL_WIN;
+	return true;
+}
+
+struct TacticsTotals {
+	int sound = 0;
+	long long nodes = 0;
+	long long extensionNodes = 0;
+	double seconds = 0;
+};
+
+int RunTactics(const TacticsOptions& options) {
+	bool original = AI::GetExtensions();
+	int failures = 0;
+	int number = 0;
+	for (const TacticsGroup& group : Groups) {
+		TacticsTotals totals[2];
+		for (int i = 0; i < group.count; i++) {
+			const TacticsPosition& position = group.positions[i];
+			Player player = position.toMove;
+			unordered_set<GameState> seen;
+			seen.insert(Parse(position));
+			AI::Move root;
+			root.illegalStates = &seen;
+			root.result = Parse(position);
+
+			// Every legal move, valued by the deeper plain search
+			AI::SetExtensions(false);
+			vector<AI::Move*> moves;
+			root.GetNextMoves(moves);
+			vector<int> values;
+			int best = -INT_MAX;
+			for (AI::Move* mv : moves) {
+				int swapPos;
+				bool vertical;
+				values.push_back(-AI::Negamax(*mv, options.oracleDepth - 1, -INT_MAX, INT_MAX, OtherPlayer(player),
+					swapPos, vertical));
+				if (values.back() > best) best = values.back();
+			}
+
+			cout << "Position " << ++number << ", " << (player == PLAYER_BLACK ? "black" : "white") << " to move, "
+				<< (best >= EVAL_WIN ? "wins" : best <= -EVAL_WIN ? "lost" : "holds") << ":";
+			for (int e = 0; e < 2; e++) {
+				AI::SetExtensions(e == 1);
+				AI::SearchControl control;
+				int swapPos;
+				bool vertical;
+				double start = Timing::Now();
+				AI::Negamax(root, options.depth, -INT_MAX, INT_MAX, player, swapPos, vertical, &control);
+				totals[e].seconds += Timing::Now() - start;
+				totals[e].nodes += control.nodes;
+				totals[e].extensionNodes += control.extensionNodes;
+				bool sound = false;
+				for (size_t m = 0; m < moves.size(); m++) {
+					if (moves[m]->swapPos == swapPos && moves[m]->vertical == vertical) sound = Sound(values[m], best);
+				}
+				if (sound) totals[e].sound++;
+				cout << (e ? "  extended " : " plain ") << (sound ? "ok" : "WRONG") << " in " << control.nodes << " nodes";
+			}
+			cout << endl;
+			for (AI::Move* mv : moves) {
+				delete mv;
+			}
+		}
+
+		cout << group.name << " positions:" << endl;
+		for (int e = 0; e < 2; e++) {
+			cout << (e ? "  Extended: " : "  Plain:    ") << totals[e].sound << "/" << group.count << " sound, "
+				<< totals[e].nodes << " nodes";
+			if (e) {
+				cout << " (" << 100.0 * (totals[1].nodes - totals[0].nodes) / totals[0].nodes << "% more, "
+					<< totals[1].extensionNodes << " past the nominal depth)";
+			}
+			cout << ", " << totals[e].seconds * 1000 << " ms" << endl;
+		}
+		failures += group.count - totals[1].sound;
+		if (totals[0].sound < group.plainBaseline) failures += group.plainBaseline - totals[0].sound;
+	}
+	AI::SetExtensions(original);
+	return failures;
+}
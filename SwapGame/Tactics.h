@@ -0,0 +1,15 @@
+#pragma once
+
+struct TacticsOptions {
+	// Depth the suite is searched at; the untimed CPU uses 3
+	int depth = 3;
+	// Depth of the plain search every legal move is checked against
+	int oracleDepth = 5;
+};
+
+// Searches fixed suites of positions with and without the threat extension,
+// printing the nodes each spent and which moves a deeper search finds
+// unsound. One suite was mined for positions the plain search gets wrong,
+// the other sampled from self-play. Returns how many positions the extended
+// search got wrong, plus how far the plain search fell short of its baseline.
+int RunTactics(const TacticsOptions& options);
@@ -0,0 +1,212 @@
+#include "TextRenderer.h"
+
+#include <iostream>
+#include <vector>
+
+#include "MinMax.h"
+#include "Profiler.h"
+#include "SDLError.h"
+
+using namespace std;
+
+TextRenderer::TextRenderer(SDL_Renderer* r, TTF_Font* f, size_t limit)
+	: renderer(r), font(f), cacheLimit(limit) {
+	lineHeight = TTF_FontHeight(font);
+	BuildAtlas();
+}
+
+TextRenderer::~TextRenderer() { }
+
+void TextRenderer::BuildAtlas() {
+	PROFILE_SCOPE("TextRenderer::BuildAtlas");
+	// Rasterize every glyph on its own, then shelf-pack them into one surface
+	SDL_Color white;
+	white.r = white.g = white.b = white.a = 255;
+	vector<SAFEPTR(SDL_Surface)> rendered(GLYPH_LAST - GLYPH_FIRST + 1);
+	int penX = 0, penY = 0;
+	for (int c = GLYPH_FIRST; c <= GLYPH_LAST; c++) {
+		Glyph& g = glyphs[c - GLYPH_FIRST];
+		g.src.x = g.src.y = g.src.w = g.src.h = 0;
+		int minX, maxX, minY, maxY;
+		if (!TTF_GlyphIsProvided(font, (Uint16)c)) continue;
+		if (TTF_GlyphMetrics(font, (Uint16)c, &minX, &maxX, &minY, &maxY, &g.advance) != 0) continue;
+		g.present = true;
+		if (c == ' ') continue;
+		// Rendering a one-character string keeps the glyph in its line box, so
+		// quads can be placed at the pen position without per-glyph offsets
+		char str[2] = { (char)c, 0 };
+		SDL_Surface* surf = TTF_RenderText_Blended(font, str, white);
+		if (!surf) throw SDLError("TTF_RenderText_Blended", TTF_GetError);
+		rendered[c - GLYPH_FIRST].reset(surf);
+		if (penX + surf->w > GLYPH_ATLAS_WIDTH) {
+			penX = 0;
+			penY += lineHeight + 1;
+		}
+		g.src.x = penX;
+		g.src.y = penY;
+		g.src.w = surf->w;
+		g.src.h = surf->h;
+		penX += surf->w + 1;
+	}
+	atlasW = GLYPH_ATLAS_WIDTH;
+	atlasH = penY + lineHeight + 1;
+
+	SDL_Surface* atlasSurf = SDL_CreateRGBSurface(0, atlasW, atlasH, 32,
+		0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+	if (!atlasSurf) throw SDLError("SDL_CreateRGBSurface");
+	MAKESAFE(SDL_Surface, atlasSurf);
+	for (int c = GLYPH_FIRST; c <= GLYPH_LAST; c++) {
+		SDL_Surface* surf = rendered[c - GLYPH_FIRST].get();
+		if (!surf) continue;
+		// Copy alpha as-is instead of blending onto the empty atlas
+		SDL_SetSurfaceBlendMode(surf, SDL_BLENDMODE_NONE);
+		SDL_Rect dest = glyphs[c - GLYPH_FIRST].src;
+		SDL_BlitSurface(surf, nullptr, atlasSurf, &dest);
+	}
+	SDL_Texture* tex = SDL_CreateTextureFromSurface(renderer, atlasSurf);
+	if (!tex) throw SDLError("SDL_CreateTextureFromSurface");
+	SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+	atlas.reset(tex);
+#ifdef _DEBUG
+	cout << "Glyph atlas: " << atlasW << "x" << atlasH << ", " << AtlasBytes() << " bytes" << endl;
+#endif
+}
+
+bool TextRenderer::InAtlas(const string& text) const {
+	for (char ch : text) {
+		int c = (unsigned char)ch;
+		if (c < GLYPH_FIRST || c > GLYPH_LAST || !glyphs[c - GLYPH_FIRST].present) return false;
+	}
+	return true;
+}
+
+const TextRenderer::CachedString& TextRenderer::CacheString(const string& text) {
+	auto found = cacheIndex.find(text);
+	if (found != cacheIndex.end()) {
+		// Move to the front of the LRU list
+		cache.splice(cache.begin(), cache, found->second);
+		return cache.front();
+	}
+	PROFILE_SCOPE("TextRenderer::RasterizeString");
+#ifdef _DEBUG
+	cout << "Rendering text: '" << text.c_str() << "'" << endl;
+#endif
+	SDL_Color white;
+	white.r = white.g = white.b = white.a = 255;
+	SDL_Surface* surf = TTF_RenderUTF8_Blended(font, text.c_str(), white);
+	if (!surf) throw SDLError("TTF_RenderUTF8_Blended", TTF_GetError);
+	MAKESAFE(SDL_Surface, surf);
+	SDL_Texture* tex = SDL_CreateTextureFromSurface(renderer, surf);
+	if (!tex) throw SDLError("SDL_CreateTextureFromSurface");
+	CachedString entry;
+	entry.text = text;
+	entry.texture.reset(tex);
+	entry.w = surf->w;
+	entry.h = surf->h;
+	cacheBytes += (size_t)entry.w * entry.h * 4;
+	cache.push_front(move(entry));
+	cacheIndex[text] = cache.begin();
+	// Evict least recently used strings, but never the one just added
+	while (cacheBytes > cacheLimit && cache.size() > 1) {
+		CachedString& last = cache.back();
+		cacheBytes -= (size_t)last.w * last.h * 4;
+		cacheIndex.erase(last.text);
+		retired.push_back(move(last.texture));
+		cache.pop_back();
+	}
+#ifdef _DEBUG
+	cout << "Text memory: " << MemoryUsage() << " bytes, " << cache.size() << " cached strings" << endl;
+#endif
+	return cache.front();
+}
+
+void TextRenderer::Measure(const string& text, SDL_Rect* bounds) {
+	bounds->x = 0;
+	bounds->y = 0;
+	if (!InAtlas(text)) {
+		const CachedString& s = CacheString(text);
+		bounds->w = s.w;
+		bounds->h = s.h;
+		return;
+	}
+	int penX = 0, right = 0;
+	Uint16 prev = 0;
+	for (char ch : text) {
+		Uint16 c = (unsigned char)ch;
+		if (prev) penX += TTF_GetFontKerningSizeGlyphs(font, prev, c);
+		const Glyph& g = glyphs[c - GLYPH_FIRST];
+		right = Max(right, penX + Max(g.src.w, g.advance));
+		penX += g.advance;
+		prev = c;
+	}
+	bounds->w = right;
+	bounds->h = lineHeight;
+}
+
+void TextRenderer::DrawQuad(SpriteBatch& batch, SDL_Texture* tex, SDL_Rect src, SDL_Rect dest, const SDL_Rect* clip) {
+	if (clip) {
+		// Quads are drawn 1:1, so clipping the destination clips the source by the same amount
+		int dx0 = Max(clip->x - dest.x, 0);
+		int dy0 = Max(clip->y - dest.y, 0);
+		int dx1 = Max(dest.x + dest.w - (clip->x + clip->w), 0);
+		int dy1 = Max(dest.y + dest.h - (clip->y + clip->h), 0);
+		src.x += dx0; dest.x += dx0;
+		src.y += dy0; dest.y += dy0;
+		src.w -= dx0 + dx1; dest.w -= dx0 + dx1;
+		src.h -= dy0 + dy1; dest.h -= dy0 + dy1;
+		if (dest.w <= 0 || dest.h <= 0) return;
+	}
+	batch.Draw(tex, &src, &dest);
+}
+
+void TextRenderer::Draw(SpriteBatch& batch, const string& text, int x, int y, const SDL_Rect* clip) {
+	if (!retired.empty()) {
+		batch.Flush();
+		retired.clear();
+	}
+	if (!InAtlas(text)) {
+		const CachedString& s = CacheString(text);
+		SDL_Rect src, dest;
+		src.x = 0;
+		src.y = 0;
+		src.w = dest.w = s.w;
+		src.h = dest.h = s.h;
+		dest.x = x;
+		dest.y = y;
+		DrawQuad(batch, s.texture.get(), src, dest, clip);
+		return;
+	}
+	int penX = x;
+	Uint16 prev = 0;
+	for (char ch : text) {
+		Uint16 c = (unsigned char)ch;
+		if (prev) penX += TTF_GetFontKerningSizeGlyphs(font, prev, c);
+		const Glyph& g = glyphs[c - GLYPH_FIRST];
+		if (g.src.w > 0) {
+			SDL_Rect dest;
+			dest.x = penX;
+			dest.y = y;
+			dest.w = g.src.w;
+			dest.h = g.src.h;
+			DrawQuad(batch, atlas.get(), g.src, dest, clip);
+		}
+		penX += g.advance;
+		prev = c;
+	}
+}
+
+size_t TextRenderer::AtlasBytes() const {
+	return (size_t)atlasW * atlasH * 4;
+}
+
+size_t TextRenderer::CacheBytes() const {
+	return cacheBytes;
+}
+
+size_t TextRenderer::MemoryUsage() const {
+	return AtlasBytes() + CacheBytes();
+}
+
+int TextRenderer::CachedStrings() const {
+	return (int)cache.size();
+}
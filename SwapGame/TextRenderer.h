@@ -0,0 +1,66 @@
+#pragma once
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+
+#include "SDLPtr.h"
+#include "SpriteBatch.h"
+
+#define GLYPH_FIRST 32
+#define GLYPH_LAST 126
+#define GLYPH_ATLAS_WIDTH 256
+#define STRING_CACHE_BYTES (256 * 1024)
+
+// Draws text as quads taken from a glyph atlas that is rasterized once.
+// Strings with characters outside the atlas are rasterized whole and kept in
+// an LRU cache bounded by texture memory.
+class TextRenderer {
+public:
+	TextRenderer(SDL_Renderer* r, TTF_Font* f, size_t cacheLimit = STRING_CACHE_BYTES);
+	~TextRenderer();
+	// Size of the text when drawn; x and y are always zero
+	void Measure(const std::string& text, SDL_Rect* bounds);
+	// Draws text with its top-left corner at (x, y), discarding anything outside clip
+	void Draw(SpriteBatch& batch, const std::string& text, int x, int y, const SDL_Rect* clip = nullptr);
+	size_t AtlasBytes() const;
+	size_t CacheBytes() const;
+	size_t MemoryUsage() const;
+	int CachedStrings() const;
+private:
+	struct Glyph {
+		SDL_Rect src;
+		int advance = 0;
+		bool present = false;
+	};
+	struct CachedString {
+		std::string text;
+		SAFEPTR(SDL_Texture) texture;
+		int w, h;
+	};
+	typedef std::list<CachedString> CacheList;
+
+	SDL_Renderer* renderer;
+	TTF_Font* font;
+	SAFEPTR(SDL_Texture) atlas;
+	int atlasW = 0, atlasH = 0;
+	int lineHeight = 0;
+	Glyph glyphs[GLYPH_LAST - GLYPH_FIRST + 1];
+
+	// Most recently used string at the front
+	CacheList cache;
+	std::unordered_map<std::string, CacheList::iterator> cacheIndex;
+	size_t cacheBytes = 0;
+	size_t cacheLimit;
+	// Evicted textures that quads still queued in a batch may use; freed
+	// once the batch has been flushed
+	std::vector<SAFEPTR(SDL_Texture)> retired;
+
+	void BuildAtlas();
+	bool InAtlas(const std::string& text) const;
+	const CachedString& CacheString(const std::string& text);
+	void DrawQuad(SpriteBatch& batch, SDL_Texture* tex, SDL_Rect src, SDL_Rect dest, const SDL_Rect* clip);
+};
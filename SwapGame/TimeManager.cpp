@@ -0,0 +1,58 @@
+#include "TimeManager.h"
+
+#include "Timing.h"
+
+using namespace std;
+
+TimeManager::TimeManager(double remaining, double increment) : start(Timing::Now()), stopped(false) {
+	double planned = remaining / MOVES_TO_GO + increment * 0.75;
+	hard = planned * HARD_LIMIT_FACTOR;
+	if (hard > remaining * MAX_MOVE_FRACTION) hard = remaining * MAX_MOVE_FRACTION;
+	hard -= SAFETY_MARGIN;
+	if (hard < 0) hard = 0;
+	soft = planned < hard ? planned : hard;
+}
+
+double TimeManager::Elapsed() const {
+	return Timing::Now() - start;
+}
+
+double TimeManager::SoftLimit() const {
+	return soft;
+}
+
+double TimeManager::HardLimit() const {
+	return hard;
+}
+
+bool TimeManager::OutOfTime() const {
+	return stopped || Elapsed() >= hard;
+}
+
+void TimeManager::Stop() {
+	stopped = true;
+}
+
+bool TimeManager::NextIteration(int score, bool bestMoveChanged, bool forcedLine) {
+	if (iterations > 0) {
+		if (bestMoveChanged) {
+			soft *= UNSTABLE_FACTOR;
+			stableIterations = 0;
+		} else {
+			stableIterations++;
+		}
+		if (stableIterations >= STABLE_ITERATIONS && !reduced) {
+			soft *= STABLE_FACTOR;
+			reduced = true;
+		}
+	}
+	bool critical = forcedLine || (iterations > 0 && lastScore - score >= CRITICAL_DROP);
+	if (critical && !extended) {
+		soft *= CRITICAL_FACTOR;
+		extended = true;
+	}
+	if (soft > hard) soft = hard;
+	iterations++;
+	lastScore = score;
+	return Elapsed() < soft * NEXT_ITERATION_FRACTION;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+
+// Share of the remaining time planned for each move
+#define MOVES_TO_GO 25
+// Most of the remaining time a single move may use
+#define MAX_MOVE_FRACTION 0.25
+// Never plan to use the last fraction of a second
+#define SAFETY_MARGIN 0.05
+// Hard limit as a multiple of the planned time
+#define HARD_LIMIT_FACTOR 5.0
+// Soft limit growth each time the best move changes, and once when a forced
+// line or a sharp drop in score first appears
+#define UNSTABLE_FACTOR 1.5
+#define CRITICAL_FACTOR 2.0
+// Score drop between iterations, in eval units, that counts as critical
+#define CRITICAL_DROP 100
+// Soft limit cut once the best move has survived this many iterations
+#define STABLE_ITERATIONS 3
+#define STABLE_FACTOR 0.6
+// Each iteration takes several times as long as the previous one, so a new
+// one only starts while this much of the soft limit is left
+#define NEXT_ITERATION_FRACTION 0.25
+
+// Decides how long an iterative-deepening search may run. The search stops
+// starting new iterations after the soft limit, which moves with the
+// stability of the results, and is aborted at the hard limit.
+class TimeManager {
+public:
+	// remaining is the time on the mover's clock when the search starts
+	TimeManager(double remaining, double increment);
+	double Elapsed() const;
+	double SoftLimit() const;
+	double HardLimit() const;
+	// True past the hard limit or once Stop has been called
+	bool OutOfTime() const;
+	// Ends the search early; safe to call from any thread
+	void Stop();
+	// Call after each completed iteration; forcedLine is set when a win or a
+	// forced loss was found among the moves. Returns whether to go deeper.
+	bool NextIteration(int score, bool bestMoveChanged, bool forcedLine);
+private:
+	double start;
+	double soft;
+	double hard;
+	int iterations = 0;
+	int stableIterations = 0;
+	int lastScore = 0;
+	bool reduced = false;
+	bool extended = false;
+	std::atomic<bool> stopped;
+};
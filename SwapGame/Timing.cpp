@@ -0,0 +1,91 @@
+#include "Timing.h"
+
+#include <chrono>
+#include <iostream>
+
+#include "MinMax.h"
+
+using namespace std;
+
+namespace Timing {
+	double Now() {
+		return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	double Milliseconds(double seconds) {
+		return seconds * 1000.0;
+	}
+
+	double FrameTiming::Total() const {
+		return update + render + present;
+	}
+
+	FrameTimer::FrameTimer() { }
+
+	void FrameTimer::Begin() {
+		double now = Now();
+		delta = haveFrame ? Min(now - frameStart, MAX_FRAME_DELTA) : 0;
+		haveFrame = true;
+		frameStart = now;
+		phaseStart = now;
+		current = FrameTiming();
+	}
+
+	void FrameTimer::EndUpdate() {
+		double now = Now();
+		current.update = now - phaseStart;
+		phaseStart = now;
+	}
+
+	void FrameTimer::EndRender() {
+		double now = Now();
+		current.render = now - phaseStart;
+		phaseStart = now;
+	}
+
+	void FrameTimer::EndPresent() {
+		double now = Now();
+		current.present = now - phaseStart;
+		phaseStart = now;
+		Record();
+	}
+
+	void FrameTimer::EndFrame() {
+		Record();
+	}
+
+	void FrameTimer::Record() {
+		history[frames % FRAME_HISTORY] = current;
+		frames++;
+		if (current.Total() > HITCH_SECONDS) {
+			hitches++;
+#ifdef _DEBUG
+			cout << "Frame hitch: update " << Milliseconds(current.update)
+				<< " ms, render " << Milliseconds(current.render)
+				<< " ms, present " << Milliseconds(current.present) << " ms" << endl;
+#endif
+		}
+	}
+
+	double FrameTimer::Delta() const {
+		return delta;
+	}
+
+	const FrameTiming& FrameTimer::Last() const {
+		return History(0);
+	}
+
+	const FrameTiming& FrameTimer::History(int framesAgo) const {
+		int i = (frames - 1 - framesAgo) % FRAME_HISTORY;
+		if (i < 0) i += FRAME_HISTORY;
+		return history[i];
+	}
+
+	int FrameTimer::Frames() const {
+		return frames;
+	}
+
+	int FrameTimer::Hitches() const {
+		return hitches;
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#define FRAME_HISTORY 120
+// Frames taking longer than this, including the present, are reported as hitches
+#define HITCH_SECONDS 0.050
+// Longest step animation is advanced by, so a stall does not teleport pieces
+#define MAX_FRAME_DELTA 0.1
+
+namespace Timing {
+	// Seconds on a monotonic clock with an arbitrary epoch. It does not need
+	// SDL, so the clocks, the search and the tools all share it.
+	double Now();
+	double Milliseconds(double seconds);
+
+	// Time spent in each phase of one frame, in seconds
+	struct FrameTiming {
+		double update = 0;
+		double render = 0;
+		double present = 0;
+		double Total() const;
+	};
+
+	// Records the phases of each frame and the time step between frames, and
+	// counts hitches. Debug builds also print each hitch as it happens.
+	// Call Begin, then EndUpdate, EndRender and EndPresent in order; frames that
+	// skip rendering call EndFrame instead of the last two.
+	class FrameTimer {
+	public:
+		FrameTimer();
+		void Begin();
+		void EndUpdate();
+		void EndRender();
+		void EndPresent();
+		void EndFrame();
+		// Seconds since the previous frame began, clamped to MAX_FRAME_DELTA
+		double Delta() const;
+		const FrameTiming& Last() const;
+		const FrameTiming& History(int framesAgo) const;
+		int Frames() const;
+		int Hitches() const;
+	private:
+		double frameStart = 0;
+		double phaseStart = 0;
+		double delta = 0;
+		bool haveFrame = false;
+		FrameTiming current;
+		FrameTiming history[FRAME_HISTORY];
+		int frames = 0;
+		int hitches = 0;
+		void Record();
+	};
+}
@@ -0,0 +1,229 @@
+#include "Tools.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "AI.h"
+#include "GameRecord.h"
+#include "IndexBuilder.h"
+#include "LeafEval.h"
+#include "PositionDB.h"
+#include "SelfPlay.h"
+#include "Tactics.h"
+#include "Timing.h"
+#include "Tuner.h"
+
+using namespace std;
+
+static int Usage() {
+	cout << "Usage:" << endl
+		<< "  SwapGame --selfplay <games> <out.swr> [random move chance] [max moves] [--seed <seed>]" << endl
+		<< "  SwapGame --tune <TunedWeights.h> <in.swr>..." << endl
+		<< "  SwapGame --bench-leaves [positions]" << endl
+		<< "  SwapGame --build-index <index.swi> <in.swr>..." << endl
+		<< "  SwapGame --query-index <index.swi> [state] [white|black]" << endl
+		<< "  SwapGame --tactics [oracle depth]" << endl;
+	return 2;
+}
+
+static int SelfPlayTool(int argc, char** argv) {
+	SelfPlayOptions options;
+	// Runs append to the same file, so each gets fresh games unless a seed is given
+	options.seed = random_device()();
+	vector<char*> args;
+	for (int i = 0; i < argc; i++) {
+		if (!strcmp(argv[i], "--seed")) {
+			if (++i == argc) return Usage();
+			options.seed = (unsigned)strtoul(argv[i], nullptr, 0);
+		} else {
+			args.push_back(argv[i]);
+		}
+	}
+	if (args.size() < 4) return Usage();
+	options.games = atoi(args[2]);
+	if (args.size() > 4) options.randomMoveChance = atof(args[4]);
+	if (args.size() > 5) options.maxMoves = atoi(args[5]);
+	cout << "Self-play seed " << options.seed << endl;
+	GameRecordWriter out(args[3]);
+	SelfPlay(options, out);
+	return 0;
+}
+
+static int TuneTool(int argc, char** argv) {
+	if (argc < 4) return Usage();
+	Tuner tuner((TunerOptions()));
+	for (int i = 3; i < argc; i++) tuner.AddRecords(argv[i]);
+	cout << "Tuning on " << tuner.Positions() << " positions" << endl;
+	EvalWeights weights = tuner.Tune(AI::GetWeights());
+	for (int f = 0; f < FEATURE_COUNT; f++) {
+		cout << "  " << Eval::FeatureName(f) << ": " << weights.w[f] << endl;
+	}
+	Tuner::WriteHeader(weights, argv[2]);
+	cout << "Wrote " << argv[2] << "; rebuild to use the new weights" << endl;
+	return 0;
+}
+
+// Times each leaf evaluation backend on the children of random positions,
+// then times whole searches with each, checking they agree with scalar
+static int BenchLeavesTool(int argc, char** argv) {
+	int count = argc > 2 ? atoi(argv[2]) : 20000;
+	if (count < 1) return Usage();
+	mt19937 rng(1);
+	vector<GameState> positions;
+	vector<GameState> leaves;
+	vector<int> siblingStart;
+	while ((int)positions.size() < count) {
+		GameState s = (1LL << (BOARD_HEIGHT / 2 * BOARD_WIDTH)) - 1;
+		int plies = rng() % 60;
+		for (int i = 0; i < plies && GetWinner(s) == PLAYER_NONE; i++) {
+			int pos = rng() % BOARD_CELLS;
+			bool vertical = !!(rng() & 1);
+			int swapPos;
+			if (DecodeMove(EncodeMove(pos, vertical), swapPos, vertical)) s = PerformSwap(s, swapPos, vertical);
+		}
+		if (GetWinner(s) != PLAYER_NONE) continue;
+		positions.push_back(s);
+		siblingStart.push_back((int)leaves.size());
+		for (int pos = 0; pos < BOARD_CELLS; pos++) {
+			for (int v = 0; v < 2; v++) {
+				int swapPos;
+				bool vertical;
+				if (DecodeMove(EncodeMove(pos, !!v), swapPos, vertical)) leaves.push_back(PerformSwap(s, swapPos, vertical));
+			}
+		}
+	}
+	siblingStart.push_back((int)leaves.size());
+	cout << positions.size() << " positions, " << leaves.size() << " leaves" << endl;
+
+	const EvalTables& tables = AI::GetTables();
+	LeafEval::Backend original = LeafEval::Active();
+	vector<int> expected(leaves.size()), scores(leaves.size());
+	vector<int> expectedMoves;
+	double scalarRate = 0;
+	for (int b = 0; b < LeafEval::BACKEND_COUNT; b++) {
+		LeafEval::Backend backend = (LeafEval::Backend)b;
+		if (!LeafEval::SetBackend(backend)) {
+			cout << LeafEval::BackendName(backend) << ": not supported" << endl;
+			continue;
+		}
+		const int rounds = 20;
+		double start = Timing::Now();
+		for (int r = 0; r < rounds; r++) {
+			Player p = r & 1 ? PLAYER_WHITE : PLAYER_BLACK;
+			for (size_t i = 0; i + 1 < siblingStart.size(); i++) {
+				int first = siblingStart[i];
+				LeafEval::Evaluate(tables, p, &leaves[first], siblingStart[i + 1] - first, &scores[first]);
+			}
+		}
+		double rate = rounds * leaves.size() / (Timing::Now() - start) / 1e6;
+		if (backend == LeafEval::BACKEND_SCALAR) {
+			expected = scores;
+			scalarRate = rate;
+		}
+		bool match = scores == expected;
+
+		// Searches are slow, so only a slice of the positions is searched
+		int searches = count < 200 ? count : 200;
+		vector<int> moves;
+		unordered_set<GameState> seen;
+		start = Timing::Now();
+		for (int i = 0; i < searches; i++) {
+			int swapPos;
+			bool vertical;
+			seen.clear();
+			seen.insert(positions[i]);
+			AI::ComputeMove(positions[i], seen, i & 1 ? PLAYER_WHITE : PLAYER_BLACK, swapPos, vertical);
+			moves.push_back(EncodeMove(swapPos, vertical));
+		}
+		double searchTime = Timing::Now() - start;
+		if (backend == LeafEval::BACKEND_SCALAR) expectedMoves = moves;
+		match = match && moves == expectedMoves;
+
+		cout << LeafEval::BackendName(backend) << ": " << rate << " M leaves/s ("
+			<< rate / scalarRate << "x), " << searchTime * 1000 / searches << " ms/search"
+			<< (match ? "" : ", MISMATCH") << endl;
+		if (!match) {
+			LeafEval::SetBackend(original);
+			return 1;
+		}
+	}
+	LeafEval::SetBackend(original);
+	return 0;
+}
+
+static int BuildIndexTool(int argc, char** argv) {
+	if (argc < 4) return Usage();
+	vector<string> records(argv + 3, argv + argc);
+	double start = Timing::Now();
+	uint64_t added = BuildIndex(argv[2], records, IndexBuildOptions());
+	PositionDB db(argv[2]);
+	cout << "Added " << added << " games in " << Timing::Now() - start << " s; the index holds "
+		<< db.Positions() << " positions and " << db.Moves() << " moves" << endl;
+	return 0;
+}
+
+static void PrintStats(const PositionStats& stats) {
+	cout << stats.Games() << " games, " << stats.wins << " won, " << stats.losses << " lost, "
+		<< stats.draws << " drawn by the side to move";
+}
+
+// Shows what the index knows about a position, the start position by default
+static int QueryIndexTool(int argc, char** argv) {
+	if (argc < 3) return Usage();
+	PositionDB db(argv[2]);
+	GameState s = argc > 3 ? (GameState)strtoull(argv[3], nullptr, 0) : (1LL << (BOARD_HEIGHT / 2 * BOARD_WIDTH)) - 1;
+	Player toMove = argc > 4 && !strcmp(argv[4], "black") ? PLAYER_BLACK : PLAYER_WHITE;
+	PositionStats stats;
+	vector<MoveEntry> moves;
+	double start = Timing::Now();
+	bool found = db.Lookup(s, toMove, stats);
+	db.NextMoves(s, toMove, moves);
+	double elapsed = Timing::Now() - start;
+	if (!found) {
+		cout << "Position not in the index" << endl;
+		return 0;
+	}
+	PrintStats(stats);
+	cout << " (" << elapsed * 1e6 << " us)" << endl;
+	for (const MoveEntry& m : moves) {
+		int swapPos;
+		bool vertical;
+		if (!DecodeMove(m.move, swapPos, vertical)) continue;
+		PositionStats next;
+		db.Lookup(PerformSwap(s, swapPos, vertical), OtherPlayer(toMove), next);
+		cout << "  " << (vertical ? "vertical " : "horizontal ") << swapPos << ": played " << m.count << ", leading to ";
+		PrintStats(next);
+		cout << endl;
+	}
+	return 0;
+}
+
+static int TacticsTool(int argc, char** argv) {
+	TacticsOptions options;
+	if (argc > 2) options.oracleDepth = atoi(argv[2]);
+	if (options.oracleDepth <= options.depth) return Usage();
+	return RunTactics(options) == 0 ? 0 : 1;
+}
+
+int RunTool(int argc, char** argv) {
+	if (argc < 2) return -1;
+	try {
+		if (!strcmp(argv[1], "--selfplay")) return SelfPlayTool(argc, argv);
+		if (!strcmp(argv[1], "--tune")) return TuneTool(argc, argv);
+		if (!strcmp(argv[1], "--bench-leaves")) return BenchLeavesTool(argc, argv);
+		if (!strcmp(argv[1], "--build-index")) return BuildIndexTool(argc, argv);
+		if (!strcmp(argv[1], "--query-index")) return QueryIndexTool(argc, argv);
+		if (!strcmp(argv[1], "--tactics")) return TacticsTool(argc, argv);
+	} catch (runtime_error& ex) {
+		cout << ex.what() << endl;
+		return 1;
+	}
+	if (!strncmp(argv[1], "--", 2)) return Usage();
+	return -1;
+}
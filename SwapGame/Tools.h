@@ -0,0 +1,5 @@
+#pragma once
+
+// Command-line tools that run instead of the game when the first argument
+// names one. Returns the process exit code, or -1 if no tool was named.
+int RunTool(int argc, char** argv);
@@ -0,0 +1,19 @@
+#pragma once
+// Evaluation weights, one per EvalFeature, in hundredths of a piece.
+// Regenerate with: SwapGame --tune TunedWeights.h <records.swr...>
+static const int TunedWeights[] = {
+	1, // Row 0 white
+	8, // Row 1 white
+	7, // Row 2 white
+	8, // Row 3 white
+	1, // Row 4 white
+	-1, // Row 5 white
+	11, // Black near win
+	-27, // White near win
+	-5, // White pairs
+	3, // Black pairs
+	1, // Black one swap from goal
+	-1, // White one swap from goal
+	74, // Black wins next
+	-105, // White wins next
+};
@@ -0,0 +1,127 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Tuner.h"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include "GameRecord.h"
+
+using namespace std;
+
+Tuner::Tuner(const TunerOptions& o) : options(o) {
+	if (options.threads <= 0) options.threads = (int)thread::hardware_concurrency();
+	if (options.threads <= 0) options.threads = 1;
+}
+
+void Tuner::AddRecords(const string& path) {
+	GameRecordReader reader(path);
+	GameRecord rec;
+	uint64_t games = 0, draws = 0;
+	int features[FEATURE_COUNT];
+	while (reader.Next(rec)) {
+		games++;
+		if (rec.winner == PLAYER_NONE) draws++;
+		const vector<GameState>& positions = reader.Positions();
+		for (size_t i = 0; i < positions.size(); i++) {
+			// Won positions are scored by search, not the evaluation
+			if (GetWinner(positions[i]) != PLAYER_NONE) continue;
+			Sample sample;
+			Eval::GetFeatures(positions[i], features);
+			for (int f = 0; f < FEATURE_COUNT; f++) sample.features[f] = (int8_t)features[f];
+			sample.result = rec.winner == PLAYER_BLACK ? 2 : rec.winner == PLAYER_WHITE ? 0 : 1;
+			samples.push_back(sample);
+		}
+	}
+	cout << path << ": " << games << " games, " << draws << " undecided" << endl;
+}
+
+size_t Tuner::Positions() const {
+	return samples.size();
+}
+
+double Tuner::LossAndGradient(const double* params, double* gradient) const {
+	const int threads = options.threads;
+	vector<double> losses(threads, 0.0);
+	vector<double> gradients(threads * PARAMS, 0.0);
+	auto worker = [&](int id) {
+		size_t begin = samples.size() * id / threads;
+		size_t end = samples.size() * (id + 1) / threads;
+		double loss = 0;
+		double* g = &gradients[id * PARAMS];
+		for (size_t i = begin; i < end; i++) {
+			const Sample& s = samples[i];
+			double eval = 0;
+			for (int f = 0; f < FEATURE_COUNT; f++) eval += params[f] * s.features[f];
+			double p = 1.0 / (1.0 + exp(-eval));
+			// Clamp so a confident wrong prediction cannot produce log(0)
+			p = fmin(fmax(p, 1e-12), 1.0 - 1e-12);
+			double y = s.result * 0.5;
+			loss -= y * log(p) + (1 - y) * log(1.0 - p);
+			double err = p - y;
+			for (int f = 0; f < FEATURE_COUNT; f++) g[f] += err * s.features[f];
+		}
+		losses[id] = loss;
+	};
+	vector<thread> pool;
+	for (int i = 1; i < threads; i++) pool.emplace_back(worker, i);
+	worker(0);
+	for (thread& t : pool) t.join();
+
+	double n = (double)samples.size();
+	double loss = 0;
+	for (int p = 0; p < PARAMS; p++) gradient[p] = 0;
+	for (int i = 0; i < threads; i++) {
+		loss += losses[i];
+		for (int p = 0; p < PARAMS; p++) gradient[p] += gradients[i * PARAMS + p];
+	}
+	loss /= n;
+	for (int p = 0; p < PARAMS; p++) {
+		gradient[p] = gradient[p] / n + 2 * options.regularization * params[p];
+		loss += options.regularization * params[p] * params[p];
+	}
+	return loss;
+}
+
+EvalWeights Tuner::Tune(const EvalWeights& start) {
+	double params[PARAMS];
+	for (int f = 0; f < FEATURE_COUNT; f++) params[f] = start.w[f] / (double)EVAL_SCALE;
+	if (samples.empty()) return start;
+
+	// Adam
+	const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+	double m[PARAMS] = {}, v[PARAMS] = {}, gradient[PARAMS];
+	double loss = 0;
+	for (int it = 1; it <= options.iterations; it++) {
+		loss = LossAndGradient(params, gradient);
+		if (it == 1 || it % 100 == 0) cout << "Iteration " << it << ": loss " << loss << endl;
+		for (int p = 0; p < PARAMS; p++) {
+			m[p] = beta1 * m[p] + (1 - beta1) * gradient[p];
+			v[p] = beta2 * v[p] + (1 - beta2) * gradient[p] * gradient[p];
+			double mHat = m[p] / (1 - pow(beta1, it));
+			double vHat = v[p] / (1 - pow(beta2, it));
+			params[p] -= options.learningRate * mHat / (sqrt(vHat) + epsilon);
+		}
+	}
+	cout << "Final loss " << LossAndGradient(params, gradient) << endl;
+
+	EvalWeights result;
+	for (int f = 0; f < FEATURE_COUNT; f++) result.w[f] = (int)lround(params[f] * EVAL_SCALE);
+	return result;
+}
+
+void Tuner::WriteHeader(const EvalWeights& weights, const string& path) {
+	FILE* f = fopen(path.c_str(), "w");
+	if (!f) throw RecordError("Cannot open " + path + " for writing");
+	fprintf(f, "#pragma once\n");
+	fprintf(f, "// Evaluation weights, one per EvalFeature, in hundredths of a piece.\n");
+	fprintf(f, "// Regenerate with: SwapGame --tune TunedWeights.h <records.swr...>\n");
+	fprintf(f, "static const int TunedWeights[] = {\n");
+	for (int i = 0; i < FEATURE_COUNT; i++) {
+		fprintf(f, "\t%d, // %s\n", weights.w[i], Eval::FeatureName(i));
+	}
+	fprintf(f, "};\n");
+	bool ok = ferror(f) == 0;
+	if (fclose(f) != 0 || !ok) throw RecordError("Failed writing " + path);
+}
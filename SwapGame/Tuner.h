@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Evaluation.h"
+
+struct TunerOptions {
+	int iterations = 2000;
+	double learningRate = 0.01;
+	// L2 penalty keeps weights of rare or redundant features near zero
+	double regularization = 1e-5;
+	int threads = 0;
+};
+
+// Fits evaluation weights to game outcomes by minimising the logistic loss
+// of sigmoid(evaluation) against the result, Texel-style. Evaluation is in
+// pieces, so the fitted weights are multiplied by EVAL_SCALE for export.
+class Tuner {
+public:
+	Tuner(const TunerOptions& options);
+	// Adds every position of each game in a record file; undecided games count as draws
+	void AddRecords(const std::string& path);
+	size_t Positions() const;
+	EvalWeights Tune(const EvalWeights& start);
+	// Writes weights as a replacement for TunedWeights.h
+	static void WriteHeader(const EvalWeights& weights, const std::string& path);
+private:
+	struct Sample {
+		int8_t features[FEATURE_COUNT];
+		// Twice black's score: 2 if black went on to win, 1 if undecided, 0 if white won
+		uint8_t result;
+	};
+	// Fitted parameters: exactly the feature weights Heuristic uses, so the
+	// fit models the evaluation the search sees
+	static const int PARAMS = FEATURE_COUNT;
+	TunerOptions options;
+	std::vector<Sample> samples;
+	double LossAndGradient(const double* params, double* gradient) const;
+};